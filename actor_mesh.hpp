@@ -0,0 +1,197 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "pin_thread.hpp"
+#include "spsc_fifo_2.hpp"
+
+/*
+	An actor-style runtime where every worker talks to every other worker over
+	its own SPSC channel.
+
+
+	The usual design for an actor runtime gives each worker one mailbox which
+	every other worker sends to. That mailbox is multi-producer, so it needs a
+	lock or a contended CAS on every message. Instead, we give each *ordered
+	pair* of workers (from, to) a dedicated SpscFifo2:
+
+		         to: 0       1       2
+		from 0:  [0,0]   [0,1]   [0,2]
+		     1:  [1,0]   [1,1]   [1,2]
+		     2:  [2,0]   [2,1]   [2,2]
+
+	Row 'from' is only ever pushed by worker 'from', and column 'to' is only
+	ever popped by worker 'to', so every channel really is single producer,
+	single consumer and every message takes the lock-free path. The cost is
+	N^2 queues, and a receiver having to poll N inbound channels instead of 1.
+
+	The scheduler loop on each worker sweeps its inbound column, draining up to
+	`batchSize` messages from each channel with `SpscFifo2::popBatch()` and
+	handing them to the user's handler.
+
+	A send to a full channel never blocks: the message is parked in a
+	per-destination backlog owned by the sending worker, and the scheduler
+	retries it every sweep. Blocking would deadlock as soon as two workers
+	filled each other's channels at the same time.
+
+	run() returns once any worker (or any other thread) calls stop(). Messages
+	still in flight at that point are discarded.
+*/
+
+struct ActorMeshConfig
+{
+	std::size_t      channelCapacity = 1024;  /* Capacity of every channel */
+	std::size_t      batchSize = 32;          /* Max messages per channel per sweep */
+
+	/* CPU for each worker. Workers with no entry, or an entry of -1, are left
+	   unpinned. */
+	std::vector<int> cpus;
+};
+
+template<typename TMessage>
+class ActorMesh
+{
+public:
+	using channel_type = SpscFifo2<TMessage>;
+	using size_type = std::size_t;
+
+	/* A worker's view of the mesh, handed to the user's callbacks.
+	   Note: Only usable from the worker thread it was given to. */
+	class Context
+	{
+	public:
+		size_type getWorker() const noexcept { return worker_; }
+
+		size_type getWorkerCount() const noexcept { return mesh_.workers_; }
+
+		/* Sends 'message' to worker 'to'. Never blocks; if the channel is
+		   full the message is queued behind any earlier ones to the same
+		   worker, so per-pair ordering is preserved. */
+		void send(size_type to, TMessage const& message)
+		{
+			auto& backlog = backlogs_[to];
+			if (backlog.empty() && mesh_.getChannel(worker_, to).push(message))
+				return;
+			backlog.push_back(message);
+		}
+
+		void stop() noexcept { mesh_.stop(); }
+
+	private:
+		friend class ActorMesh;
+
+		Context(ActorMesh& mesh, size_type worker)
+			: mesh_{mesh}
+			, worker_{worker}
+			, backlogs_(mesh.workers_)
+		{}
+
+		/* Retries parked messages, oldest first. */
+		void flush()
+		{
+			for (size_type to = 0; to < backlogs_.size(); ++to)
+			{
+				auto& backlog = backlogs_[to];
+				auto& channel = mesh_.getChannel(worker_, to);
+				while (!backlog.empty() && channel.push(backlog.front()))
+					backlog.pop_front();
+			}
+		}
+
+		ActorMesh&                        mesh_;
+		size_type                         worker_;
+		std::vector<std::deque<TMessage>> backlogs_;
+	};
+
+	explicit ActorMesh(size_type workers, ActorMeshConfig config = {})
+		: config_{std::move(config)}
+		, workers_{workers}
+	{
+		assert(workers > 0);
+		if (config_.batchSize == 0)
+			config_.batchSize = 1;
+
+		/* Note: SpscFifo2 can't be moved, so each channel lives on the heap
+		   behind a unique_ptr. */
+		channels_.reserve(workers_ * workers_);
+		for (size_type i = 0; i < workers_ * workers_; ++i)
+			channels_.push_back(
+				std::make_unique<channel_type>(config_.channelCapacity));
+	}
+
+	ActorMesh(ActorMesh const&) = delete;
+	ActorMesh& operator=(ActorMesh const&) = delete;
+	ActorMesh(ActorMesh&&) = delete;
+	ActorMesh& operator=(ActorMesh&&) = delete;
+
+	size_type getWorkerCount() const noexcept { return workers_; }
+
+	/* Runs one thread per worker until stop() is called. Each worker first
+	   calls 'start(Context&)' once, then 'handler(Context&, size_type from,
+	   TMessage& message)' for every message it receives. Call at most once. */
+	template<typename TStart, typename THandler>
+	void run(TStart start, THandler handler)
+	{
+		std::vector<std::jthread> threads;
+		threads.reserve(workers_);
+		for (size_type w = 0; w < workers_; ++w)
+		{
+			threads.emplace_back([this, w, &start, &handler] {
+				runWorker(w, start, handler);
+			});
+		}
+		/* Note: std::jthread (C++20) joins on destruction. */
+	}
+
+	/* Asks every worker to return from its scheduler loop. Safe to call from
+	   any thread. */
+	void stop() noexcept { stop_.store(true, std::memory_order_relaxed); }
+
+private:
+	channel_type& getChannel(size_type from, size_type to) noexcept
+	{
+		return *channels_[from * workers_ + to];
+	}
+
+	template<typename TStart, typename THandler>
+	void runWorker(size_type worker, TStart& start, THandler& handler)
+	{
+		const int cpu =
+			worker < config_.cpus.size() ? config_.cpus[worker] : -1;
+		pinThread(cpu, ::pthread_self());
+
+		Context context{*this, worker};
+		start(context);
+
+		std::vector<TMessage> buffer(config_.batchSize);
+		while (!stop_.load(std::memory_order_relaxed))
+		{
+			context.flush();
+			for (size_type from = 0; from < workers_; ++from)
+			{
+				auto& channel = getChannel(from, worker);
+				const size_type n =
+					channel.popBatch(buffer.data(), buffer.size());
+				for (size_type i = 0; i < n; ++i)
+					handler(context, from, buffer[i]);
+			}
+		}
+	}
+
+	ActorMeshConfig                            config_;
+	size_type                                  workers_;
+
+	/* channels_[from * workers_ + to] */
+	std::vector<std::unique_ptr<channel_type>> channels_;
+
+	/* Note: Read by every worker on every sweep, but only written once, so
+	   keep it away from anything that is written often. */
+	alignas(64) std::atomic<bool>              stop_{};
+	char padding_[64 - sizeof(std::atomic<bool>)];
+};
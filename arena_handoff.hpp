@@ -0,0 +1,244 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "spsc_fifo_2.hpp"
+
+/*
+	Hands variable-sized object graphs from a Producer to a Consumer through
+	an SpscFifo2 of pointers, with the objects carved out of a bump arena and
+	recycled in bulk.
+
+
+	If the Producer `new`s every object of a message and the Consumer `delete`s
+	them, each object costs a cross-thread free - memory allocated on one
+	thread and returned on another, which is expensive for nearly every general
+	purpose allocator. Here, instead:
+
+		1. The Producer bump-allocates a message's objects out of the current
+		   arena 'chunk' with `make<U>()` (or `allocate()`), then push()es a
+		   pointer to the message's root object through the SpscFifo2.
+
+		2. The Consumer pop()s the pointer, uses the message, and then
+		   `release()`s it. Releasing just bumps a counter - the 'epoch' -
+		   which the Consumer publishes with Release ordering.
+
+		3. When the Producer runs out of room in the current chunk, it seals
+		   it, noting the epoch at which every message that could have
+		   objects in it will have been released. Sealed chunks are recycled
+		   whole - a single pointer reset - once the Consumer's epoch has
+		   reached that point.
+
+	Messages are released in FIFO order (this is a FIFO, after all), so the
+	epoch alone says exactly which messages the Consumer has finished with.
+	The Producer only reads the epoch when it has to change chunks, so the
+	counter's cache line is rarely bounced.
+
+	No destructors are ever run for arena objects, so they must be trivially
+	destructible.
+*/
+
+template<typename T>
+class ArenaHandoff
+{
+public:
+	using queue_type = SpscFifo2<T*>;
+	using size_type = typename queue_type::size_type;
+
+	/* Note: 'chunkSize' is in bytes and bounds the largest single
+	   allocation. A 'maxChunks' of 0 lets the arena grow without limit while
+	   the Consumer falls behind; otherwise allocation fails once 'maxChunks'
+	   chunks are all in use. A message's objects may straddle the end of a
+	   chunk, and the chunk it started in can't be recycled until the message
+	   is released, so a limited arena needs at least two chunks - and as
+	   many as the largest message spans. */
+	ArenaHandoff(size_type queueCapacity, size_type chunkSize,
+		size_type maxChunks = 0)
+		: queue_{queueCapacity}
+		, chunk_size_{chunkSize}
+		, max_chunks_{maxChunks}
+	{
+		assert(maxChunks == 0 || maxChunks >= 2);
+	}
+
+	ArenaHandoff(ArenaHandoff const&) = delete;
+	ArenaHandoff& operator=(ArenaHandoff const&) = delete;
+	ArenaHandoff(ArenaHandoff&&) = delete;
+	ArenaHandoff& operator=(ArenaHandoff&&) = delete;
+
+	/* Number of chunks allocated so far. */
+	size_type getChunkCount() const noexcept { return chunks_.size(); }
+
+	/* Bump-allocates 'bytes' for the message currently being built. Returns
+	   nullptr if there's no chunk free and no more may be allocated.
+	   Note: 'alignment' can be at most that of the chunks themselves.
+	   Note: Producer thread only. */
+	void* allocate(size_type bytes, size_type alignment = alignof(std::max_align_t))
+	{
+		assert(bytes <= chunk_size_);
+		assert(alignment <= chunk_alignment);
+		if (current_ != nullptr)
+		{
+			const size_type offset = alignUp(current_->used, alignment);
+			if (offset + bytes <= chunk_size_)
+			{
+				current_->used = offset + bytes;
+				building_in_current_ = true;
+				return current_->data + offset;
+			}
+			seal();
+		}
+
+		current_ = acquireChunk();
+		if (current_ == nullptr)
+			return nullptr;
+		current_->used = bytes;
+		building_in_current_ = true;
+		return current_->data;
+	}
+
+	/* Constructs a U in the arena. Returns nullptr if allocate() fails.
+	   Note: Producer thread only. */
+	template<typename U, typename... TArgs>
+	U* make(TArgs&&... args)
+	{
+		static_assert(std::is_trivially_destructible_v<U>,
+			"Arena objects are never destroyed");
+		static_assert(alignof(U) <= chunk_alignment,
+			"Arena objects can't be aligned beyond a chunk");
+		void* storage = allocate(sizeof(U), alignof(U));
+		if (storage == nullptr)
+			return nullptr;
+		return new (storage) U(std::forward<TArgs>(args)...);
+	}
+
+	/* Hands 'message', and everything allocated since the previous push(),
+	   to the Consumer. Returns false if the queue is full.
+	   Note: Producer thread only. */
+	bool push(T* message)
+	{
+		if (!queue_.push(message))
+			return false;
+		++pushed_;
+		building_in_current_ = false;
+		return true;
+	}
+
+	/* Returns the oldest message, or nullptr if the queue is empty. The
+	   message stays valid until it is release()d.
+	   Note: Consumer thread only. */
+	T* pop()
+	{
+		T* message;
+		return queue_.pop(message) ? message : nullptr;
+	}
+
+	/* Marks the 'n' oldest popped-but-unreleased messages as finished with.
+	   Releasing in batches means fewer stores to the shared epoch.
+	   Note: Consumer thread only. */
+	void release(size_type n = 1)
+	{
+		released_local_ += n;
+		/* Note: Writing variable read by other thread: Release! Every read
+		   of the released messages happens-before the Producer reuses their
+		   memory. */
+		released_.store(released_local_, std::memory_order_release);
+	}
+
+private:
+	struct Chunk
+	{
+		explicit Chunk(size_type size)
+			: data{static_cast<std::byte*>(::operator new(size,
+				std::align_val_t{chunk_alignment}))}
+		{}
+
+		~Chunk() { ::operator delete(data, std::align_val_t{chunk_alignment}); }
+
+		std::byte*    data;
+		size_type     used{};
+		std::uint64_t epoch{};  /* Reusable once released_ reaches this */
+	};
+
+	static constexpr size_type chunk_alignment = 64;
+
+	static size_type alignUp(size_type offset, size_type alignment) noexcept
+	{
+		return (offset + alignment - 1) / alignment * alignment;
+	}
+
+	/* Retires the current chunk. It may hold objects of every message pushed
+	   so far, and of the one being built - number 'pushed_ + 1' - if that has
+	   allocated anything in it yet. If it hasn't, the chunk mustn't wait for
+	   that message to be released too: it may well be the one message which
+	   can't be pushed until the chunk is recycled. */
+	void seal()
+	{
+		current_->epoch = building_in_current_ ? pushed_ + 1 : pushed_;
+		building_in_current_ = false;
+		sealed_.push_back(current_);
+		current_ = nullptr;
+	}
+
+	Chunk* acquireChunk()
+	{
+		if (free_.empty())
+			reclaim();
+
+		if (!free_.empty())
+		{
+			Chunk* chunk = free_.back();
+			free_.pop_back();
+			return chunk;
+		}
+
+		if (max_chunks_ != 0 && chunks_.size() == max_chunks_)
+			return nullptr;
+
+		chunks_.push_back(std::make_unique<Chunk>(chunk_size_));
+		return chunks_.back().get();
+	}
+
+	/* Moves every sealed chunk whose messages have all been released onto
+	   the free list. Chunks are sealed in order, so we can stop at the first
+	   one which is still in use. */
+	void reclaim()
+	{
+		/* Note: Reading variable written to by other thread: Acquire! */
+		const std::uint64_t released =
+			released_.load(std::memory_order_acquire);
+		while (!sealed_.empty() && sealed_.front()->epoch <= released)
+		{
+			free_.push_back(sealed_.front());
+			sealed_.pop_front();
+		}
+	}
+
+	queue_type queue_;
+
+	/* Exclusive to Producer thread. */
+	size_type                           chunk_size_;
+	size_type                           max_chunks_;
+	std::vector<std::unique_ptr<Chunk>> chunks_;   /* Owns every chunk */
+	std::deque<Chunk*>                  sealed_;   /* Full, oldest first */
+	std::vector<Chunk*>                 free_;
+	Chunk*                              current_{};
+	bool                                building_in_current_{};  /* current_ holds part of the unpushed message */
+	std::uint64_t                       pushed_{};
+
+	/* Written by the Consumer thread, read by the Producer thread. */
+	alignas(64) std::atomic<std::uint64_t> released_{};
+
+	/* Exclusive to Consumer thread. */
+	alignas(64) std::uint64_t released_local_{};
+	char padding_[64 - sizeof(std::uint64_t)];
+};
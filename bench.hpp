@@ -2,8 +2,8 @@
 
 #include <chrono>
 #include <cstdint>
-#include <cstdio>
 #include <cstdlib>
+#include <fstream>
 #include <iomanip>
 #include <iostream>
 #include <stdexcept>
@@ -11,25 +11,33 @@
 #include <utility>
 
 #include <pthread.h>
+#include <unistd.h>
+
+#include "pin_thread.hpp"
 
 template<typename T>
 inline __attribute__((always_inline)) void doNotOptimize(T const& value) {
 	asm volatile("" : : "r,m" (value) : "memory");
 }
 
-static void pinThread(int cpu) {
-	if (cpu < 0) {
-		return;
-	}
-	::cpu_set_t cpuset;
-	CPU_ZERO(&cpuset);
-	CPU_SET(cpu, &cpuset);
-	if (::pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset) == -1) {
-		std::perror("pthread_setaffinity_rp");
+/* Pins the calling thread to 'cpu', or leaves it be if 'cpu' is negative.
+   A benchmark on the wrong core measures the wrong thing, so give up if the
+   affinity can't be set. */
+inline void pinThread(int cpu) {
+	if (!pinThread(cpu, ::pthread_self())) {
+		std::cerr << "pinThread: cannot pin to CPU " << cpu << '\n';
 		std::exit(EXIT_FAILURE);
 	}
 }
 
+/* Resident set size in bytes, from /proc/self/statm. */
+inline std::size_t getRss() {
+	std::size_t pages = 0;
+	std::size_t resident = 0;
+	std::ifstream{"/proc/self/statm"} >> pages >> resident;
+	return resident * static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+}
+
 template<typename T>
 struct isRigtorp : std::false_type {};
 
@@ -0,0 +1,154 @@
+#include "bench.hpp"
+#include "actor_mesh.hpp"
+
+#include <mutex>
+#include <vector>
+
+/* Message throughput of ActorMesh against a mutex-protected mailbox per
+   worker, for 4 to 64 workers. Each worker starts with a few tokens and
+   forwards every token it receives to another worker until the token runs
+   out of hops. Workers are pinned to consecutive CPUs starting at argv[1]. */
+
+/* The usual design: one multi-producer mailbox per worker, guarded by a
+   mutex. Exposes the same run()/Context interface as ActorMesh. */
+template<typename TMessage>
+class MutexMailboxMesh
+{
+public:
+	using size_type = std::size_t;
+
+	class Context
+	{
+	public:
+		size_type getWorker() const noexcept { return worker_; }
+		size_type getWorkerCount() const noexcept { return mesh_.workers_; }
+
+		void send(size_type to, TMessage const& message) {
+			auto& mailbox = *mesh_.mailboxes_[to];
+			std::lock_guard lock{mailbox.mutex};
+			mailbox.messages.emplace_back(worker_, message);
+		}
+
+		void stop() noexcept { mesh_.stop(); }
+
+	private:
+		friend class MutexMailboxMesh;
+		Context(MutexMailboxMesh& mesh, size_type worker)
+			: mesh_{mesh}, worker_{worker} {}
+
+		MutexMailboxMesh& mesh_;
+		size_type         worker_;
+	};
+
+	MutexMailboxMesh(size_type workers, ActorMeshConfig config)
+		: config_{std::move(config)}, workers_{workers} {
+		for (size_type i = 0; i < workers_; ++i) {
+			mailboxes_.push_back(std::make_unique<Mailbox>());
+		}
+	}
+
+	template<typename TStart, typename THandler>
+	void run(TStart start, THandler handler) {
+		std::vector<std::jthread> threads;
+		for (size_type w = 0; w < workers_; ++w) {
+			threads.emplace_back([this, w, &start, &handler] {
+				pinThread(w < config_.cpus.size() ? config_.cpus[w] : -1,
+					::pthread_self());
+				Context context{*this, w};
+				start(context);
+				std::vector<std::pair<size_type, TMessage>> local;
+				auto& mailbox = *mailboxes_[w];
+				while (!stop_.load(std::memory_order_relaxed)) {
+					{
+						std::lock_guard lock{mailbox.mutex};
+						local.swap(mailbox.messages);
+					}
+					for (auto& [from, message] : local) {
+						handler(context, from, message);
+					}
+					local.clear();
+				}
+			});
+		}
+	}
+
+	void stop() noexcept { stop_.store(true, std::memory_order_relaxed); }
+
+private:
+	struct alignas(64) Mailbox {
+		std::mutex mutex;
+		std::vector<std::pair<size_type, TMessage>> messages;
+	};
+
+	ActorMeshConfig                       config_;
+	size_type                             workers_;
+	std::vector<std::unique_ptr<Mailbox>> mailboxes_;
+	alignas(64) std::atomic<bool>         stop_{};
+};
+
+struct Token {
+	std::uint32_t id;
+	std::uint32_t hops;
+};
+
+template<typename TMesh>
+static auto benchMesh(std::size_t workers, long iters, int cpu) {
+	using namespace std::chrono_literals;
+
+	constexpr std::uint32_t tokensPerWorker = 8;
+	const auto tokens = static_cast<std::uint32_t>(workers) * tokensPerWorker;
+	const auto hops = static_cast<std::uint32_t>(iters / tokens);
+
+	ActorMeshConfig config;
+	config.channelCapacity = 256;
+	for (std::size_t w = 0; w < workers; ++w) {
+		config.cpus.push_back(cpu < 0 ? -1 : cpu + static_cast<int>(w));
+	}
+
+	TMesh mesh{workers, config};
+	alignas(64) std::atomic<std::uint32_t> retired{0};
+
+	auto start = [&](auto& context) {
+		for (std::uint32_t t = 0; t < tokensPerWorker; ++t) {
+			const auto id =
+				static_cast<std::uint32_t>(context.getWorker()) * tokensPerWorker + t;
+			context.send(context.getWorker(), Token{id, hops});
+		}
+	};
+	auto handler = [&](auto& context, std::size_t, Token& token) {
+		if (--token.hops == 0) {
+			if (retired.fetch_add(1, std::memory_order_relaxed) + 1 == tokens) {
+				context.stop();
+			}
+			return;
+		}
+		const auto n = context.getWorkerCount();
+		const auto to = (context.getWorker() + 1 + token.id % n) % n;
+		context.send(to, token);
+	};
+
+	auto begin = std::chrono::steady_clock::now();
+	mesh.run(start, handler);
+	auto end = std::chrono::steady_clock::now();
+
+	return (static_cast<long>(tokens) * hops * 1s)/(end - begin);
+}
+
+int main(int argc, char* argv[]) {
+	int cpu = 1;
+	if (argc >= 2) {
+		cpu = std::atoi(argv[1]);
+	}
+
+	constexpr auto iters = 20'000'000l;
+
+	std::cout.imbue(std::locale(""));
+	for (std::size_t workers : {4, 8, 16, 32, 64}) {
+		auto spscOps = benchMesh<ActorMesh<Token>>(workers, iters, cpu);
+		auto mutexOps = benchMesh<MutexMailboxMesh<Token>>(workers, iters, cpu);
+		std::cout << "Workers=" << workers << ": "
+			<< "ActorMesh " << std::fixed << spscOps << " msgs/s, "
+			<< "MutexMailboxMesh " << mutexOps << " msgs/s\n";
+	}
+	return 0;
+}
@@ -0,0 +1,94 @@
+#include "bench.hpp"
+#include "cache_aligned_allocator.hpp"
+#include "spsc_fifo_2.hpp"
+
+/* Throughput of SpscFifo2 with odd-sized payloads - 24 B, which straddles a
+   cache line every third slot, and 72 B, which always does - for a buffer
+   from std::allocator, one aligned to 64 and 128 bytes, and one with every
+   slot padded to whole cache lines. */
+
+template<std::size_t Bytes>
+struct Payload {
+	std::int64_t words[Bytes / sizeof(std::int64_t)];
+
+	explicit Payload(std::int64_t i = 0) {
+		for (auto& word : words) {
+			word = i;
+		}
+	}
+};
+
+template<typename TQueue, typename TPayload>
+static void benchQueue(char const* name, long iters, int cpu1, int cpu2) {
+	using namespace std::chrono_literals;
+	using value_type = typename TQueue::value_type;
+
+	constexpr auto fifoSize = 131072;
+
+	TQueue q{fifoSize};
+
+	auto t = std::jthread([&] {
+		pinThread(cpu1);
+		value_type val;
+		for (long i = 0; i < fifoSize + iters; ++i) {
+			while (auto again = not q.pop(val)) {
+				doNotOptimize(again);
+			}
+			if (static_cast<TPayload const&>(val).words[0] != i) {
+				throw std::runtime_error("invalid value");
+			}
+		}
+	});
+
+	pinThread(cpu2);
+	// warmup
+	for (long i = 0; i < fifoSize; ++i) {
+		while (auto again = not q.push(value_type{TPayload{i}})) {
+			doNotOptimize(again);
+		}
+	}
+	while (auto again = not q.isEmpty()) {
+		doNotOptimize(again);
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	for (long i = fifoSize; i < fifoSize + iters; ++i) {
+		while (auto again = not q.push(value_type{TPayload{i}})) {
+			doNotOptimize(again);
+		}
+	}
+	t.join();
+	auto stop = std::chrono::steady_clock::now();
+
+	std::cout << name << " (" << sizeof(TPayload) << " B payload, "
+		<< sizeof(value_type) << " B slot): "
+		<< std::fixed << (iters * 1s)/(stop - start) << " ops/s\n";
+}
+
+template<typename TPayload>
+static void benchPayload(long iters, int cpu1, int cpu2) {
+	benchQueue<SpscFifo2<TPayload, std::allocator<TPayload>>, TPayload>(
+		"std::allocator", iters, cpu1, cpu2);
+	benchQueue<SpscFifo2<TPayload, CacheAlignedAllocator<TPayload, 64>>, TPayload>(
+		"64 B aligned", iters, cpu1, cpu2);
+	benchQueue<SpscFifo2<TPayload, CacheAlignedAllocator<TPayload, 128>>, TPayload>(
+		"128 B aligned", iters, cpu1, cpu2);
+	benchQueue<SpscFifo2<CacheLinePadded<TPayload>>, TPayload>(
+		"64 B aligned, padded slots", iters, cpu1, cpu2);
+}
+
+int main(int argc, char* argv[]) {
+	int cpu1 = 1;
+	int cpu2 = 2;
+	if (argc == 3) {
+		cpu1 = std::atoi(argv[1]);
+		cpu2 = std::atoi(argv[2]);
+	}
+
+	constexpr auto iters = 20'000'000l;
+
+	std::cout.imbue(std::locale(""));
+	benchPayload<Payload<24>>(iters, cpu1, cpu2);
+	benchPayload<Payload<72>>(iters, cpu1, cpu2);
+	return 0;
+}
@@ -0,0 +1,72 @@
+#include "bench.hpp"
+#include "compact_spsc_fifo.hpp"
+#include "queue_slab.hpp"
+#include "spsc_fifo_2.hpp"
+
+#include <memory>
+#include <vector>
+
+/* Memory per queue for 20,000 small, mostly-idle queues - SpscFifo2 on the
+   heap against CompactSpscFifo in a QueueSlab - followed by the usual
+   single-queue throughput bench for both layouts. */
+
+constexpr std::size_t queueCount = 20'000;
+constexpr std::size_t queueCapacity = 16;
+
+template<typename TQueue>
+static void touch(TQueue& q) {
+	std::int64_t val = 0;
+	for (std::size_t i = 0; i < queueCapacity; ++i) {
+		q.push(static_cast<std::int64_t>(i));
+	}
+	while (q.pop(val)) {
+		doNotOptimize(val);
+	}
+}
+
+static void benchMemorySpscFifo2() {
+	using queue_type = SpscFifo2<std::int64_t>;
+	const auto before = getRss();
+	std::vector<std::unique_ptr<queue_type>> queues;
+	queues.reserve(queueCount);
+	const auto reserved = getRss();
+	for (std::size_t i = 0; i < queueCount; ++i) {
+		queues.push_back(std::make_unique<queue_type>(queueCapacity));
+		touch(*queues.back());
+	}
+	const auto after = getRss();
+	std::cout << "SpscFifo2 (heap): sizeof " << sizeof(queue_type)
+		<< " B, RSS " << (after - reserved) / queueCount << " B/queue"
+		<< " (+" << (reserved - before) / queueCount << " B/queue for the pointers)\n";
+}
+
+static void benchMemoryCompact() {
+	using queue_type = CompactSpscFifo<std::int64_t, SlabAllocator<std::int64_t>>;
+	const auto before = getRss();
+	QueueSlab slab{queueCount * (sizeof(queue_type) + queueCapacity * sizeof(std::int64_t))};
+	std::vector<queue_type*> queues;
+	queues.reserve(queueCount);
+	const auto reserved = getRss();
+	for (std::size_t i = 0; i < queueCount; ++i) {
+		queues.push_back(slab.create<queue_type>(queueCapacity,
+			SlabAllocator<std::int64_t>{slab}));
+		touch(*queues.back());
+	}
+	const auto after = getRss();
+	std::cout << "CompactSpscFifo (slab" << (slab.isHugePages() ? ", huge pages" : "")
+		<< "): sizeof " << sizeof(queue_type)
+		<< " B, slab " << slab.getUsed() / queueCount << " B/queue"
+		<< ", RSS " << (after - reserved) / queueCount << " B/queue"
+		<< " (+" << (reserved - before) / queueCount << " B/queue for the pointers)\n";
+	for (auto* q : queues) {
+		slab.destroy(q);
+	}
+}
+
+int main(int argc, char* argv[]) {
+	benchMemorySpscFifo2();
+	benchMemoryCompact();
+	bench<SpscFifo2>("SpscFifo2", argc, argv);
+	bench<CompactSpscFifo>("CompactSpscFifo", argc, argv);
+	return 0;
+}
@@ -0,0 +1,99 @@
+#include "bench.hpp"
+#include "deadline_fifo.hpp"
+
+/* Catch-up time after a Consumer stall. The Producer pushes timestamped items
+   flat out while the Consumer sleeps, filling the queue with items that
+   expire long before the Consumer wakes. We then time how long the Consumer
+   takes to reach its first live item: DeadlineFifo skips the expired run
+   with one binary search, the naive Consumer pops and drops items one by
+   one. The Consumer is pinned to argv[1] and the Producer to argv[2]. */
+
+struct Stamped {
+	std::int64_t timestamp;
+	std::int64_t value;
+};
+
+static std::int64_t nowNs() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+constexpr auto fifoSize = 1 << 20;
+constexpr std::int64_t maxAgeNs = 10'000;
+
+/* Drops expired items one at a time. */
+struct NaiveDeadlineFifo {
+	NaiveDeadlineFifo() : fifo{fifoSize} {}
+
+	bool push(Stamped const& value) { return fifo.push(value); }
+
+	bool pop(Stamped& value, std::int64_t now) {
+		while (fifo.pop(value)) {
+			if (now - value.timestamp <= maxAgeNs) {
+				return true;
+			}
+			++dropped;
+		}
+		return false;
+	}
+
+	std::uint64_t getDropCount() const { return dropped; }
+
+	SpscFifo2<Stamped> fifo;
+	std::uint64_t dropped{};
+};
+
+struct BulkDeadlineFifo : DeadlineFifo<Stamped> {
+	BulkDeadlineFifo() : DeadlineFifo<Stamped>{fifoSize, maxAgeNs} {}
+};
+
+template<typename T>
+static void benchCatchUp(char const* name, std::chrono::milliseconds stall,
+	int cpu1, int cpu2) {
+	T q;
+	std::atomic<bool> stop{false};
+
+	auto producer = std::jthread([&] {
+		pinThread(cpu2);
+		for (std::int64_t i = 0; !stop.load(std::memory_order_relaxed); ++i) {
+			while (auto again = not q.push(Stamped{nowNs(), i})) {
+				if (stop.load(std::memory_order_relaxed)) {
+					return;
+				}
+				doNotOptimize(again);
+			}
+		}
+	});
+
+	pinThread(cpu1);
+	std::this_thread::sleep_for(stall);
+
+	auto start = std::chrono::steady_clock::now();
+	Stamped val;
+	while (auto again = not q.pop(val, nowNs())) {
+		doNotOptimize(again);
+	}
+	auto stop_time = std::chrono::steady_clock::now();
+	stop.store(true, std::memory_order_relaxed);
+
+	std::cout << name << ": caught up in "
+		<< std::chrono::duration_cast<std::chrono::microseconds>(
+			stop_time - start).count() << " us, "
+		<< q.getDropCount() << " items dropped\n";
+}
+
+int main(int argc, char* argv[]) {
+	using namespace std::chrono_literals;
+
+	int cpu1 = 1;
+	int cpu2 = 2;
+	if (argc == 3) {
+		cpu1 = std::atoi(argv[1]);
+		cpu2 = std::atoi(argv[2]);
+	}
+
+	std::cout.imbue(std::locale(""));
+	benchCatchUp<BulkDeadlineFifo>("DeadlineFifo", 500ms, cpu1, cpu2);
+	benchCatchUp<NaiveDeadlineFifo>("Naive per-item drop", 500ms, cpu1, cpu2);
+	return 0;
+}
@@ -0,0 +1,72 @@
+#include "bench.hpp"
+#include "doorbell_fifo.hpp"
+#include "spsc_fifo_2.hpp"
+
+/* Round-trip latency of a signal: one thread push()es a value into a queue,
+   the other pop()s it and push()es it back on a second queue, and the first
+   waits for it - DoorbellFifo against SpscFifo2 of the same capacity. */
+
+constexpr std::size_t capacity = 8;
+
+using value_type = std::uint32_t;
+
+template<typename TQueue>
+static void benchPingPong(char const* name, TQueue& ping, TQueue& pong,
+	long iters, int cpu1, int cpu2) {
+	auto t = std::jthread([&] {
+		pinThread(cpu1);
+		value_type val;
+		for (long i = 0; i < iters; ++i) {
+			while (auto again = not ping.pop(val)) {
+				doNotOptimize(again);
+			}
+			while (auto again = not pong.push(val)) {
+				doNotOptimize(again);
+			}
+		}
+	});
+
+	pinThread(cpu2);
+	value_type val;
+	auto start = std::chrono::steady_clock::now();
+	for (long i = 0; i < iters; ++i) {
+		while (auto again = not ping.push(static_cast<value_type>(i))) {
+			doNotOptimize(again);
+		}
+		while (auto again = not pong.pop(val)) {
+			doNotOptimize(again);
+		}
+		if (val != static_cast<value_type>(i)) {
+			throw std::runtime_error("invalid value");
+		}
+	}
+	auto stop = std::chrono::steady_clock::now();
+	t.join();
+
+	std::cout << name << " (" << sizeof(TQueue) << " B): "
+		<< std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count() / iters
+		<< " ns/round trip\n";
+}
+
+int main(int argc, char* argv[]) {
+	int cpu1 = 1;
+	int cpu2 = 2;
+	if (argc == 3) {
+		cpu1 = std::atoi(argv[1]);
+		cpu2 = std::atoi(argv[2]);
+	}
+
+	constexpr auto iters = 10'000'000l;
+
+	{
+		DoorbellFifo<value_type, capacity> ping;
+		DoorbellFifo<value_type, capacity> pong;
+		benchPingPong("DoorbellFifo", ping, pong, iters, cpu1, cpu2);
+	}
+	{
+		SpscFifo2<value_type> ping{capacity};
+		SpscFifo2<value_type> pong{capacity};
+		benchPingPong("SpscFifo2", ping, pong, iters, cpu1, cpu2);
+	}
+	return 0;
+}
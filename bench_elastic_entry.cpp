@@ -0,0 +1,74 @@
+#include "bench.hpp"
+#include "elastic_spsc_fifo.hpp"
+#include "spsc_fifo_2.hpp"
+
+/* Resident memory of a queue sized for a burst: fill and drain it once, then
+   keep a trickle of traffic going and see how much of the ring stays
+   resident - SpscFifo2 against ElasticSpscFifo with MADV_DONTNEED and
+   MADV_FREE. Then the usual throughput bench, to show push() and pop() cost
+   the same as SpscFifo2's. */
+
+constexpr std::size_t burstCapacity = 8 << 20;  // 64 MB of int64s
+
+template<typename TQueue>
+static void burst(TQueue& q) {
+	std::int64_t val = 0;
+	for (std::size_t i = 0; i < burstCapacity; ++i) {
+		q.push(static_cast<std::int64_t>(i));
+	}
+	while (q.pop(val)) {
+		doNotOptimize(val);
+	}
+}
+
+template<typename TQueue, typename TIdle>
+static void trickle(TQueue& q, TIdle idle) {
+	using namespace std::chrono_literals;
+	std::int64_t val = 0;
+	for (int round = 0; round < 10; ++round) {
+		for (std::int64_t i = 0; i < 1000; ++i) {
+			q.push(i);
+			q.pop(val);
+			doNotOptimize(val);
+		}
+		std::this_thread::sleep_for(20ms);
+		idle();
+	}
+}
+
+static void report(char const* name, std::size_t base, std::size_t burst,
+	std::size_t idle) {
+	std::cout << name << ": RSS after burst " << (burst - base) / (1 << 20)
+		<< " MB, after idling " << (idle - base) / (1 << 20) << " MB\n";
+}
+
+static void benchMemorySpscFifo2() {
+	const auto base = getRss();
+	SpscFifo2<std::int64_t> q{burstCapacity};
+	burst(q);
+	const auto afterBurst = getRss();
+	trickle(q, [] {});
+	report("SpscFifo2", base, afterBurst, getRss());
+}
+
+static void benchMemoryElastic(char const* name, int advice) {
+	using namespace std::chrono_literals;
+	using queue_type = ElasticSpscFifo<std::int64_t>;
+	const auto base = getRss();
+	queue_type q{burstCapacity, queue_type::Config{100ms, advice, 1}};
+	burst(q);
+	const auto afterBurst = getRss();
+	trickle(q, [&] { q.trim(); });
+	report(name, base, afterBurst, getRss());
+	std::cout << "  " << q.getReleasedCount() << " pages released\n";
+}
+
+int main(int argc, char* argv[]) {
+	std::cout.imbue(std::locale(""));
+	benchMemorySpscFifo2();
+	benchMemoryElastic("ElasticSpscFifo (MADV_DONTNEED)", MADV_DONTNEED);
+	benchMemoryElastic("ElasticSpscFifo (MADV_FREE)", MADV_FREE);
+	bench<SpscFifo2>("SpscFifo2", argc, argv);
+	bench<ElasticSpscFifo>("ElasticSpscFifo", argc, argv);
+	return 0;
+}
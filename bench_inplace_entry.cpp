@@ -0,0 +1,94 @@
+#include "bench.hpp"
+#include "spsc_fifo_2.hpp"
+
+/* The ways the Consumer of an SpscFifo2 can take items off: one pop() per
+   item, popBatch() into a buffer, and consumeN() in place. The batches
+   publish pop_pos_ once per run rather than once per item; consumeN() also
+   skips the copy into the buffer, which matters more the larger the item.
+   Run for an 8-byte and a 64-byte item. The correctness checks of the
+   in-place operations are in check_inplace_entry.cpp. */
+
+struct Small {
+	std::int64_t seq;
+};
+
+struct Large {
+	std::int64_t seq;
+	std::int64_t payload[7];
+};
+
+static_assert(sizeof(Large) == 64);
+
+enum class Consume { pop, popBatch, consumeN };
+
+constexpr auto fifoSize = 131072;
+constexpr std::size_t batchSize = 256;
+
+template<typename T, Consume How>
+static void benchConsume(char const* name, long iters, int cpu1, int cpu2) {
+	using namespace std::chrono_literals;
+
+	SpscFifo2<T> q{fifoSize};
+
+	auto t = std::jthread([&] {
+		pinThread(cpu1);
+		long consumed = 0;
+		auto check = [&](T const& item) {
+			if (item.seq != consumed) {
+				throw std::runtime_error("invalid value");
+			}
+			++consumed;
+		};
+
+		while (consumed < iters) {
+			if constexpr (How == Consume::pop) {
+				T item;
+				if (q.pop(item)) {
+					check(item);
+				}
+			} else if constexpr (How == Consume::popBatch) {
+				T buffer[batchSize];
+				const auto n = q.popBatch(buffer, batchSize);
+				for (std::size_t i = 0; i < n; ++i) {
+					check(buffer[i]);
+				}
+			} else {
+				q.consumeN(check, batchSize);
+			}
+		}
+	});
+
+	pinThread(cpu2);
+	auto start = std::chrono::steady_clock::now();
+	for (long i = 0; i < iters; ++i) {
+		T item{};
+		item.seq = i;
+		while (auto again = not q.push(item)) {
+			doNotOptimize(again);
+		}
+	}
+	t.join();
+	auto stop = std::chrono::steady_clock::now();
+
+	std::cout << name << ": " << std::fixed << (iters * 1s)/(stop - start) << " ops/s\n";
+}
+
+int main(int argc, char* argv[]) {
+	int cpu1 = 1;
+	int cpu2 = 2;
+	if (argc == 3) {
+		cpu1 = std::atoi(argv[1]);
+		cpu2 = std::atoi(argv[2]);
+	}
+
+	constexpr auto iters = 20'000'000l;
+
+	std::cout.imbue(std::locale(""));
+	benchConsume<Small, Consume::pop>("8 B, pop()", iters, cpu1, cpu2);
+	benchConsume<Small, Consume::popBatch>("8 B, popBatch(256)", iters, cpu1, cpu2);
+	benchConsume<Small, Consume::consumeN>("8 B, consumeN(256)", iters, cpu1, cpu2);
+	benchConsume<Large, Consume::pop>("64 B, pop()", iters, cpu1, cpu2);
+	benchConsume<Large, Consume::popBatch>("64 B, popBatch(256)", iters, cpu1, cpu2);
+	benchConsume<Large, Consume::consumeN>("64 B, consumeN(256)", iters, cpu1, cpu2);
+	return 0;
+}
@@ -0,0 +1,21 @@
+#include "bench.hpp"
+#include "spsc_fifo_2.hpp"
+
+/* SpscFifo2 with its position variables 64 bytes apart - one cache line -
+   against 128 bytes apart, for CPUs whose spatial prefetcher pulls in lines
+   in pairs. Both use the same 128-byte-aligned buffer, so the separation of
+   the positions is the only difference. */
+
+template<typename T>
+using SpscFifo2x64 = SpscFifo2<T, CacheAlignedAllocator<T, 128>, 64>;
+
+template<typename T>
+using SpscFifo2x128 = SpscFifo2<T, CacheAlignedAllocator<T, 128>, 128>;
+
+int main(int argc, char* argv[]) {
+	std::cout << "sizeof(SpscFifo2x64): " << sizeof(SpscFifo2x64<std::int64_t>) << " B, "
+		<< "sizeof(SpscFifo2x128): " << sizeof(SpscFifo2x128<std::int64_t>) << " B\n";
+	bench<SpscFifo2x64>("SpscFifo2 (64 B separation)", argc, argv);
+	bench<SpscFifo2x128>("SpscFifo2 (128 B separation)", argc, argv);
+	return 0;
+}
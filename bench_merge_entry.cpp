@@ -0,0 +1,79 @@
+#include "bench.hpp"
+#include "merge_fifo.hpp"
+
+/* MergeFifo with one input live but idle. A backlog queued behind it must
+   wait out the lateness bound once, and then drain at full speed - not wait
+   out the bound again for every item. With a lateness of zero, an idle
+   input must not hold up the merge at all. Single-threaded: the Consumer is
+   pinned to argv[1]. */
+
+struct Stamped {
+	std::int64_t timestamp;
+	std::int64_t value;
+};
+
+static void benchBacklog(std::chrono::milliseconds lateness,
+	std::chrono::milliseconds queued, long items) {
+	MergeFifo<Stamped> merge{2, static_cast<std::size_t>(items), lateness};
+
+	/* Note: Input 1 stays live and empty throughout. */
+	for (long i = 0; i < items; ++i) {
+		if (!merge.getInput(0).push(Stamped{i, i})) {
+			throw std::runtime_error("input full");
+		}
+	}
+
+	/* The Consumer finds the idle input, then the items sit queued for
+	   longer than the lateness bound. */
+	Stamped val;
+	long popped = 0;
+	if (merge.pop(val)) {
+		++popped;
+	} else if (lateness.count() == 0) {
+		throw std::runtime_error("idle input held up a zero-lateness merge");
+	}
+	std::this_thread::sleep_for(queued);
+
+	long stalls = 0;
+	auto start = std::chrono::steady_clock::now();
+	while (popped < items) {
+		if (merge.pop(val)) {
+			if (val.value != popped) {
+				throw std::runtime_error("invalid value");
+			}
+			++popped;
+		} else {
+			++stalls;
+		}
+	}
+	auto stop = std::chrono::steady_clock::now();
+
+	std::cout << "lateness " << lateness.count() << " ms, " << items
+		<< " items queued for " << queued.count() << " ms: drained in "
+		<< std::chrono::duration_cast<std::chrono::microseconds>(stop - start).count()
+		<< " us ("
+		<< std::chrono::duration<double, std::nano>(stop - start).count() / items
+		<< " ns/item), " << stalls << " pop()s returned false\n";
+
+	/* Note: Once the bound has expired, nothing may wait it out again. */
+	if (stalls != 0) {
+		throw std::runtime_error("backlog stalled behind an idle input");
+	}
+}
+
+int main(int argc, char* argv[]) {
+	using namespace std::chrono_literals;
+
+	int cpu = 1;
+	if (argc == 2) {
+		cpu = std::atoi(argv[1]);
+	}
+	pinThread(cpu);
+
+	std::cout.imbue(std::locale(""));
+	benchBacklog(20ms, 100ms, 20);
+	benchBacklog(20ms, 100ms, 1'000'000);
+	benchBacklog(0ms, 0ms, 10);
+	benchBacklog(0ms, 0ms, 1'000'000);
+	return 0;
+}
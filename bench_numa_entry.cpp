@@ -0,0 +1,91 @@
+#include "bench.hpp"
+#include "numa.hpp"
+#include "spsc_fifo_2.hpp"
+
+/* Throughput of SpscFifo2 with its slots and its control lines placed on
+   different NUMA nodes: the default first-touch placement, the Consumer's
+   node, the Producer's node, and - if there is one - a node neither thread
+   runs on. On a single-node machine every placement is the same node, so
+   the numbers should match. */
+
+using value_type = std::int64_t;
+using queue_type = SpscFifo2<value_type, NumaAllocator<value_type>>;
+
+constexpr auto fifoSize = 131072;
+
+static void benchPlacement(char const* name, int ringNode, int controlNode,
+	long iters, int cpu1, int cpu2) {
+	using namespace std::chrono_literals;
+
+	auto q = makeOnNumaNode<queue_type>(controlNode, fifoSize,
+		NumaAllocator<value_type>{ringNode});
+
+	auto t = std::jthread([&] {
+		pinThread(cpu1);
+		value_type val;
+		for (auto i = value_type{}; i < fifoSize + iters; ++i) {
+			while (auto again = not q->pop(val)) {
+				doNotOptimize(again);
+			}
+			if (val != i) {
+				throw std::runtime_error("invalid value");
+			}
+		}
+	});
+
+	pinThread(cpu2);
+	// warmup: one lap, so that first-touch placement has happened
+	for (auto i = value_type{}; i < fifoSize; ++i) {
+		while (auto again = not q->push(i)) {
+			doNotOptimize(again);
+		}
+	}
+	while (auto again = not q->isEmpty()) {
+		doNotOptimize(again);
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	for (auto i = value_type{fifoSize}; i < fifoSize + iters; ++i) {
+		while (auto again = not q->push(i)) {
+			doNotOptimize(again);
+		}
+	}
+	t.join();
+	auto stop = std::chrono::steady_clock::now();
+
+	std::cout << name << " (ring on node " << ringNode
+		<< ", control on node " << controlNode << "): "
+		<< std::fixed << (iters * 1s)/(stop - start) << " ops/s\n";
+}
+
+int main(int argc, char* argv[]) {
+	int cpu1 = 1;
+	int cpu2 = 2;
+	if (argc == 3) {
+		cpu1 = std::atoi(argv[1]);
+		cpu2 = std::atoi(argv[2]);
+	}
+
+	constexpr auto iters = 20'000'000l;
+
+	const auto nodes = getNumaNodes();
+	const int consumerNode = getNumaNodeOfCpu(cpu1 < 0 ? 0 : cpu1);
+	const int producerNode = getNumaNodeOfCpu(cpu2 < 0 ? 0 : cpu2);
+
+	std::cout.imbue(std::locale(""));
+	std::cout << nodes.size() << " NUMA node(s); consumer on node " << consumerNode
+		<< ", producer on node " << producerNode << "\n";
+
+	benchPlacement("first touch", -1, -1, iters, cpu1, cpu2);
+	benchPlacement("consumer's node", consumerNode, consumerNode, iters, cpu1, cpu2);
+	benchPlacement("producer's node", producerNode, producerNode, iters, cpu1, cpu2);
+	benchPlacement("ring on consumer's, control on producer's", consumerNode,
+		producerNode, iters, cpu1, cpu2);
+	for (int node : nodes) {
+		if (node != consumerNode && node != producerNode) {
+			benchPlacement("remote node", node, node, iters, cpu1, cpu2);
+			break;
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,78 @@
+#include "bench.hpp"
+#include "pipeline.hpp"
+
+#include <algorithm>
+#include <vector>
+
+/* End-to-end latency of one item through a Pipeline of N pass-through
+   stages, for N = 1..4. The source only emits the next item once the sink has
+   received the previous one, so each sample is the latency of an unloaded
+   traversal. Threads are pinned to consecutive CPUs starting at argv[1]. */
+
+static std::int64_t nowNs() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+template<std::size_t... I>
+static void benchPipeline(std::index_sequence<I...>, long iters, int cpu) {
+	constexpr auto stages = sizeof...(I);
+
+	PipelineConfig config;
+	for (std::size_t i = 0; i < stages + 2; ++i) {
+		config.cpus.push_back(cpu < 0 ? -1 : cpu + static_cast<int>(i));
+	}
+
+	std::atomic<long> received{0};
+	long sent = 0;
+	std::vector<std::int64_t> latencies;
+	latencies.reserve(iters);
+
+	auto source = [&]() -> std::optional<std::int64_t> {
+		if (sent == iters) {
+			return std::nullopt;
+		}
+		while (auto again = received.load(std::memory_order_acquire) != sent) {
+			doNotOptimize(again);
+		}
+		++sent;
+		return nowNs();
+	};
+	auto stage = [](std::int64_t t) { return t; };
+	auto sink = [&](std::int64_t t) {
+		latencies.push_back(nowNs() - t);
+		received.store(received.load(std::memory_order_relaxed) + 1,
+			std::memory_order_release);
+	};
+
+	auto p = pipeline(config, source, ((void)I, stage)..., sink);
+	p.run();
+
+	std::sort(latencies.begin(), latencies.end());
+	std::cout << "Pipeline N=" << stages << ": "
+		<< "p50 " << latencies[latencies.size() / 2] << " ns, "
+		<< "p99 " << latencies[latencies.size() * 99 / 100] << " ns, "
+		<< "max " << latencies.back() << " ns\n";
+	for (auto const& stats : p.getStats()) {
+		std::cout << "  " << std::fixed << stats.getThroughput() << " items/s"
+			<< ", mean depth " << stats.getMeanDepth()
+			<< ", max depth " << stats.maxDepth
+			<< (stats.pinned ? "" : " (unpinned)") << "\n";
+	}
+}
+
+int main(int argc, char* argv[]) {
+	int cpu = 1;
+	if (argc >= 2) {
+		cpu = std::atoi(argv[1]);
+	}
+
+	constexpr auto iters = 1'000'000l;
+
+	std::cout.imbue(std::locale(""));
+	benchPipeline(std::make_index_sequence<1>{}, iters, cpu);
+	benchPipeline(std::make_index_sequence<2>{}, iters, cpu);
+	benchPipeline(std::make_index_sequence<3>{}, iters, cpu);
+	benchPipeline(std::make_index_sequence<4>{}, iters, cpu);
+	return 0;
+}
@@ -0,0 +1,93 @@
+#include "bench.hpp"
+#include "prefetch_fifo.hpp"
+
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <vector>
+
+/* A queue of pointers into a 64 MB pool of two-line messages, pushed in
+   random order. The Consumer reads the first and last word of each message,
+   so it misses on both lines of nearly every one. Compared: no prefetching,
+   prefetching one line and both lines ahead of use, and a longer distance. */
+
+struct Message {
+	std::int64_t head;
+	std::int64_t body[14];
+	std::int64_t tail;
+};
+
+static_assert(sizeof(Message) == 128);
+
+constexpr std::size_t poolSize = 512 * 1024;  // 64 MB
+
+template<std::size_t Distance>
+static void benchPrefetch(char const* name, std::vector<Message> const& pool,
+	std::vector<std::uint32_t> const& order, std::uint32_t lines,
+	long iters, int cpu1, int cpu2) {
+	using namespace std::chrono_literals;
+
+	constexpr auto fifoSize = 4096;
+	constexpr std::size_t batchSize = 256;
+
+	PrefetchFifo<Message const, Distance> q{fifoSize, lines};
+
+	std::int64_t expected = 0;
+	for (long i = 0; i < iters; ++i) {
+		auto const& m = pool[order[i % order.size()]];
+		expected += m.head + m.tail;
+	}
+
+	auto t = std::jthread([&] {
+		pinThread(cpu1);
+		long consumed = 0;
+		std::int64_t sum = 0;
+		while (consumed < iters) {
+			consumed += q.consumeN([&](Message const* m) {
+				sum += m->head + m->tail;
+			}, batchSize);
+		}
+		if (sum != expected) {
+			throw std::runtime_error("invalid value");
+		}
+	});
+
+	pinThread(cpu2);
+	auto start = std::chrono::steady_clock::now();
+	for (long i = 0; i < iters; ++i) {
+		while (auto again = not q.push(&pool[order[i % order.size()]])) {
+			doNotOptimize(again);
+		}
+	}
+	t.join();
+	auto stop = std::chrono::steady_clock::now();
+
+	std::cout << name << ": " << std::fixed << (iters * 1s)/(stop - start) << " ops/s\n";
+}
+
+int main(int argc, char* argv[]) {
+	int cpu1 = 1;
+	int cpu2 = 2;
+	if (argc == 3) {
+		cpu1 = std::atoi(argv[1]);
+		cpu2 = std::atoi(argv[2]);
+	}
+
+	constexpr auto iters = 20'000'000l;
+
+	std::vector<Message> pool(poolSize);
+	for (std::size_t i = 0; i < poolSize; ++i) {
+		pool[i].head = static_cast<std::int64_t>(i);
+		pool[i].tail = static_cast<std::int64_t>(i) * 3;
+	}
+	std::vector<std::uint32_t> order(poolSize);
+	std::iota(order.begin(), order.end(), 0u);
+	std::shuffle(order.begin(), order.end(), std::mt19937{42});
+
+	std::cout.imbue(std::locale(""));
+	benchPrefetch<8>("no prefetch", pool, order, 0, iters, cpu1, cpu2);
+	benchPrefetch<8>("prefetch 1 line, distance 8", pool, order, 1, iters, cpu1, cpu2);
+	benchPrefetch<8>("prefetch 2 lines, distance 8", pool, order, 2, iters, cpu1, cpu2);
+	benchPrefetch<16>("prefetch 2 lines, distance 16", pool, order, 2, iters, cpu1, cpu2);
+	return 0;
+}
@@ -0,0 +1,57 @@
+#include "bench.hpp"
+#include "prewarm.hpp"
+#include "spsc_fifo_2.hpp"
+
+/* Cold-start cost: the time for the first lap of push()es through a fresh
+   SpscFifo2 - with and without prewarm() - against a second, steady-state
+   lap through the same queue. */
+
+constexpr std::size_t fifoSize = 1 << 20;  // 8 MB of int64s
+
+using queue_type = SpscFifo2<std::int64_t>;
+
+/* Average ns per push() for one full lap, draining afterwards. */
+static double lap(queue_type& q) {
+	auto start = std::chrono::steady_clock::now();
+	for (std::size_t i = 0; i < fifoSize; ++i) {
+		q.push(static_cast<std::int64_t>(i));
+	}
+	auto stop = std::chrono::steady_clock::now();
+
+	std::int64_t val = 0;
+	while (q.pop(val)) {
+		doNotOptimize(val);
+	}
+	return std::chrono::duration<double, std::nano>(stop - start).count() / fifoSize;
+}
+
+template<typename TPrepare>
+static void benchLaps(char const* name, TPrepare prepare) {
+	queue_type q{fifoSize};
+	auto start = std::chrono::steady_clock::now();
+	const bool ok = prepare(q);
+	auto stop = std::chrono::steady_clock::now();
+	const double first = lap(q);
+	const double second = lap(q);
+	std::cout << name << ": "
+		<< "prepare " << std::chrono::duration_cast<std::chrono::microseconds>(stop - start).count() << " us"
+		<< (ok ? "" : " (failed)") << ", "
+		<< std::setprecision(2) << std::fixed
+		<< "first lap " << first << " ns/push, "
+		<< "second lap " << second << " ns/push\n";
+}
+
+int main(int argc, char* argv[]) {
+	int cpu1 = 1;
+	if (argc >= 2) {
+		cpu1 = std::atoi(argv[1]);
+	}
+
+	benchLaps("cold", [](queue_type&) { return true; });
+	benchLaps("prewarm()", [](queue_type& q) { return q.prewarm(); });
+	benchLaps("prewarm(lock)", [](queue_type& q) { return q.prewarm(true); });
+	benchLaps("prewarmOnCpu(consumer)", [&](queue_type& q) {
+		return prewarmOnCpu(q, cpu1);
+	});
+	return 0;
+}
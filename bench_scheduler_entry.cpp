@@ -0,0 +1,155 @@
+#include "bench.hpp"
+#include "spsc_scheduler.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+/* Round-trip hop latency of SpscRunLoop against a condition-variable-based
+   run loop. Each sample starts an operation on the loop's thread and spins
+   until its receiver signals back. The loop's thread is pinned to argv[1] and
+   the submitting thread to argv[2]. */
+
+/* The usual design: a mutex-protected queue of operation states, with the
+   loop's thread sleeping on a condition variable. Same schedule()/connect()/
+   start() shape as SpscRunLoop. */
+class CvRunLoop
+{
+	struct OperationBase {
+		void (*execute)(OperationBase*) noexcept;
+	};
+
+public:
+	template<typename TReceiver>
+	class Operation : private OperationBase
+	{
+	public:
+		Operation(CvRunLoop* loop, TReceiver receiver)
+			: OperationBase{&executeImpl}, loop_{loop}, receiver_{std::move(receiver)} {}
+		Operation(Operation&&) = delete;
+
+		void start() noexcept { loop_->enqueue(this); }
+
+	private:
+		static void executeImpl(OperationBase* base) noexcept {
+			static_cast<Operation*>(base)->receiver_.set_value();
+		}
+
+		CvRunLoop* loop_;
+		TReceiver  receiver_;
+	};
+
+	struct ScheduleSender {
+		template<typename TReceiver>
+		Operation<TReceiver> connect(TReceiver receiver) const {
+			return Operation<TReceiver>{loop, std::move(receiver)};
+		}
+		CvRunLoop* loop;
+	};
+
+	struct Scheduler {
+		ScheduleSender schedule() const noexcept { return ScheduleSender{loop}; }
+		CvRunLoop* loop;
+	};
+
+	CvRunLoop(std::size_t, int cpu) : thread_{[this, cpu] { run(cpu); }} {}
+
+	~CvRunLoop() {
+		{
+			std::lock_guard lock{mutex_};
+			finishing_ = true;
+		}
+		cv_.notify_one();
+		thread_.join();
+	}
+
+	Scheduler getScheduler() noexcept { return Scheduler{this}; }
+
+private:
+	void enqueue(OperationBase* operation) {
+		{
+			std::lock_guard lock{mutex_};
+			queue_.push_back(operation);
+		}
+		cv_.notify_one();
+	}
+
+	void run(int cpu) {
+		pinThread(cpu, ::pthread_self());
+		std::unique_lock lock{mutex_};
+		for (;;) {
+			cv_.wait(lock, [this] { return finishing_ || !queue_.empty(); });
+			if (queue_.empty()) {
+				return;
+			}
+			auto* operation = queue_.front();
+			queue_.pop_front();
+			lock.unlock();
+			operation->execute(operation);
+			lock.lock();
+		}
+	}
+
+	std::mutex                 mutex_;
+	std::condition_variable    cv_;
+	std::deque<OperationBase*> queue_;
+	bool                       finishing_{};
+	std::thread                thread_;
+};
+
+struct SignalReceiver {
+	std::atomic<bool>* done;
+
+	void set_value() noexcept {
+		done->store(true, std::memory_order_release);
+	}
+};
+
+template<typename TLoop>
+static void benchHop(char const* name, long iters, int cpu1, int cpu2) {
+	std::vector<std::int64_t> latencies;
+	latencies.reserve(iters);
+	{
+		TLoop loop{1024, cpu1};
+		pinThread(cpu2);
+		auto scheduler = loop.getScheduler();
+
+		alignas(64) std::atomic<bool> done;
+		for (long i = 0; i < iters; ++i) {
+			done.store(false, std::memory_order_relaxed);
+			auto start = std::chrono::steady_clock::now();
+			auto op = scheduler.schedule().connect(SignalReceiver{&done});
+			op.start();
+			while (auto again = not done.load(std::memory_order_acquire)) {
+				doNotOptimize(again);
+			}
+			auto stop = std::chrono::steady_clock::now();
+			latencies.push_back(
+				std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count());
+		}
+	}
+
+	std::sort(latencies.begin(), latencies.end());
+	std::cout << name << ": "
+		<< "p50 " << latencies[latencies.size() / 2] << " ns, "
+		<< "p99 " << latencies[latencies.size() * 99 / 100] << " ns, "
+		<< "max " << latencies.back() << " ns\n";
+}
+
+int main(int argc, char* argv[]) {
+	int cpu1 = 1;
+	int cpu2 = 2;
+	if (argc == 3) {
+		cpu1 = std::atoi(argv[1]);
+		cpu2 = std::atoi(argv[2]);
+	}
+
+	constexpr auto iters = 1'000'000l;
+
+	std::cout.imbue(std::locale(""));
+	benchHop<SpscRunLoop>("SpscRunLoop", iters, cpu1, cpu2);
+	benchHop<CvRunLoop>("CvRunLoop", iters, cpu1, cpu2);
+	return 0;
+}
@@ -0,0 +1,76 @@
+#include "bench.hpp"
+#include "sharded_fifo.hpp"
+
+#include <vector>
+
+/* Scaling bench for ShardedFifo: one Producer, K Workers and one Reassembler,
+   for K = 1..8. Threads are pinned to consecutive CPUs starting at argv[1]. */
+
+static auto benchSharded(std::size_t lanes, long iters, int cpu) {
+	using namespace std::chrono_literals;
+	using value_type = std::int64_t;
+
+	ShardedFifo<value_type> q{lanes, 4096};
+
+	std::vector<std::jthread> workers;
+	for (std::size_t k = 0; k < lanes; ++k) {
+		workers.emplace_back([&q, k, lanes, iters, cpu] {
+			pinThread(cpu < 0 ? -1 : cpu + 2 + static_cast<int>(k));
+			// Worker 'k' sees every K-th item of the stream.
+			const long count = iters / static_cast<long>(lanes)
+				+ (static_cast<long>(k) < iters % static_cast<long>(lanes));
+			Sequenced<value_type> item;
+			for (long i = 0; i < count; ++i) {
+				while (auto again = not q.workerPop(k, item)) {
+					doNotOptimize(again);
+				}
+				item.value *= 2;
+				while (auto again = not q.workerPush(k, item)) {
+					doNotOptimize(again);
+				}
+			}
+		});
+	}
+
+	auto consumer = std::jthread([&] {
+		pinThread(cpu < 0 ? -1 : cpu + 1);
+		value_type val;
+		for (auto i = value_type{}; i < iters; ++i) {
+			while (auto again = not q.pop(val)) {
+				doNotOptimize(again);
+			}
+			if (val != i * 2) {
+				throw std::runtime_error("invalid value");
+			}
+		}
+	});
+
+	pinThread(cpu);
+	auto start = std::chrono::steady_clock::now();
+	for (auto i = value_type{}; i < iters; ++i) {
+		while (auto again = not q.push(i)) {
+			doNotOptimize(again);
+		}
+	}
+	consumer.join();
+	auto stop = std::chrono::steady_clock::now();
+
+	return (iters * 1s)/(stop - start);
+}
+
+int main(int argc, char* argv[]) {
+	int cpu = 1;
+	if (argc >= 2) {
+		cpu = std::atoi(argv[1]);
+	}
+
+	constexpr auto iters = 20'000'000l;
+
+	std::cout.imbue(std::locale(""));
+	for (std::size_t lanes = 1; lanes <= 8; ++lanes) {
+		auto opsPerSec = benchSharded(lanes, iters, cpu);
+		std::cout << "ShardedFifo K=" << lanes << ": "
+			<< std::fixed << opsPerSec << " ops/s\n";
+	}
+	return 0;
+}
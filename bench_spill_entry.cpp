@@ -0,0 +1,100 @@
+#include "bench.hpp"
+#include "spill_fifo.hpp"
+
+#include <cstdio>
+#include <filesystem>
+#include <string>
+
+#include <linux/magic.h>
+#include <sys/vfs.h>
+
+/* Stress bench for SpillFifo. The Consumer stalls for a few seconds before
+   it starts popping, so the Producer overflows the in-memory ring into the
+   spill file and keeps going at full speed. Every item is checked for order
+   once the Consumer catches up. Then the same run again without a stall,
+   where the spill should go untouched.
+
+   Usage: bench_spill_entry [cpu1 cpu2 [spill-directory]]
+
+   The 100M-item run spills about 800 MB. By default that goes to the
+   system's temporary directory, which is often a tmpfs - i.e. RAM - so to
+   actually exercise a disk, pass a directory on one. */
+
+static void benchSpill(char const* name, long iters, std::chrono::milliseconds stall,
+	std::string const& directory, int cpu1, int cpu2) {
+	using namespace std::chrono_literals;
+	using value_type = std::int64_t;
+
+	constexpr auto fifoSize = 131072;
+
+	SpillFifo<value_type> q{fifoSize, static_cast<std::size_t>(iters),
+		MmapFileAllocator<value_type>{directory}};
+
+	auto t = std::jthread([&] {
+		pinThread(cpu1);
+		std::this_thread::sleep_for(stall);
+		value_type val;
+		for (auto i = value_type{}; i < iters; ++i) {
+			while (auto again = not q.pop(val)) {
+				doNotOptimize(again);
+			}
+			if (val != i) {
+				throw std::runtime_error("invalid value");
+			}
+		}
+	});
+
+	pinThread(cpu2);
+	auto start = std::chrono::steady_clock::now();
+	for (auto i = value_type{}; i < iters; ++i) {
+		while (auto again = not q.push(i)) {
+			doNotOptimize(again);
+		}
+	}
+	auto pushed = std::chrono::steady_clock::now();
+	t.join();
+	auto stop = std::chrono::steady_clock::now();
+
+	auto toMs = [](auto d) {
+		return std::chrono::duration_cast<std::chrono::milliseconds>(d).count();
+	};
+	std::cout << name << ": "
+		<< "producer done in " << toMs(pushed - start) << " ms, "
+		<< "consumer done in " << toMs(stop - start) << " ms, "
+		<< q.getSpillCount() << " items spilled, "
+		<< std::fixed << (iters * 1s)/(stop - start) << " ops/s\n";
+}
+
+int main(int argc, char* argv[]) {
+	using namespace std::chrono_literals;
+
+	int cpu1 = 1;
+	int cpu2 = 2;
+	std::string directory = std::filesystem::temp_directory_path().string();
+	if (argc >= 3) {
+		cpu1 = std::atoi(argv[1]);
+		cpu2 = std::atoi(argv[2]);
+	}
+	if (argc >= 4) {
+		directory = argv[3];
+	}
+
+	struct ::statfs fs;
+	if (::statfs(directory.c_str(), &fs) != 0) {
+		std::perror(directory.c_str());
+		return EXIT_FAILURE;
+	}
+	std::cout << "Spilling to " << directory;
+	if (fs.f_type == TMPFS_MAGIC) {
+		std::cout << " (tmpfs: memory, not disk - pass a directory on a disk"
+			" as the third argument)";
+	}
+	std::cout << '\n';
+
+	constexpr auto iters = 100'000'000l;
+
+	std::cout.imbue(std::locale(""));
+	benchSpill("SpillFifo (3s consumer stall)", iters, 3s, directory, cpu1, cpu2);
+	benchSpill("SpillFifo (no stall)", iters, 0s, directory, cpu1, cpu2);
+	return 0;
+}
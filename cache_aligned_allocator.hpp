@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <utility>
+
+/*
+	An allocator whose blocks start on a cache line and end on one.
+
+
+	`std::allocator<T>` only promises `alignof(T)`. In practice a large block
+	from malloc() starts 16 bytes into a line. So the first slot of a ring
+	can share a line with the allocator's bookkeeping, and so can the last
+	slot with whatever gets allocated next. Any writes to those neighbours
+	then false-share with the queue.
+
+	CacheAlignedAllocator asks the aligned operator new (C++17) for blocks
+	aligned to 'Alignment' and rounds their size up to a whole number of
+	lines, so nothing else can live on the buffer's lines. This is the default
+	allocator of SpscFifo0, SpscFifo1 and SpscFifo2. Use an Alignment of 128
+	on CPUs whose adjacent-line prefetcher fetches lines in pairs, as Intel's
+	does.
+
+	Aligning the buffer keeps its ends clean, but a slot can still straddle
+	two lines if sizeof(T) doesn't divide the line size - a 24-byte T does
+	every third slot, a 72-byte T always does. For payloads close to a line,
+	CacheLinePadded<T> rounds each slot up to whole lines:
+
+		SpscFifo2<CacheLinePadded<Quote>> q{4096};
+		q.push(quote);
+		CacheLinePadded<Quote> out;
+		q.pop(out);  // out.value
+
+	See: https://en.cppreference.com/w/cpp/memory/new/operator_new
+*/
+
+template<typename T, std::size_t Alignment = 64>
+class CacheAlignedAllocator
+{
+	static_assert((Alignment & (Alignment - 1)) == 0,
+		"Alignment must be a power of two");
+
+public:
+	using value_type = T;
+
+	static constexpr std::size_t alignment =
+		Alignment > alignof(T) ? Alignment : alignof(T);
+
+	/* Note: allocator_traits can't rebind a template with a non-type
+	   parameter by itself. */
+	template<typename U>
+	struct rebind { using other = CacheAlignedAllocator<U, Alignment>; };
+
+	CacheAlignedAllocator() noexcept = default;
+
+	template<typename U>
+	CacheAlignedAllocator(CacheAlignedAllocator<U, Alignment> const&) noexcept {}
+
+	T* allocate(std::size_t n)
+	{
+		return static_cast<T*>(::operator new(toBytes(n), std::align_val_t{alignment}));
+	}
+
+	void deallocate(T* p, std::size_t n) noexcept
+	{
+		::operator delete(p, toBytes(n), std::align_val_t{alignment});
+	}
+
+	template<typename U>
+	bool operator==(CacheAlignedAllocator<U, Alignment> const&) const noexcept
+	{
+		return true;
+	}
+
+private:
+	static std::size_t toBytes(std::size_t n) noexcept
+	{
+		return (n * sizeof(T) + alignment - 1) / alignment * alignment;
+	}
+};
+
+/* A T padded (and aligned) to a whole number of cache lines. */
+template<typename T, std::size_t Alignment = 64>
+struct alignas(Alignment) CacheLinePadded
+{
+	T value;
+
+	CacheLinePadded() = default;
+
+	/* Note: Deliberately implicit, so a T can be push()ed as is. */
+	CacheLinePadded(T const& v) : value{v} {}
+	CacheLinePadded(T&& v) : value{std::move(v)} {}
+
+	operator T&() noexcept { return value; }
+	operator T const&() const noexcept { return value; }
+};
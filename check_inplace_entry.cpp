@@ -0,0 +1,216 @@
+#include "bench.hpp"
+#include "spsc_fifo_2.hpp"
+
+/* Correctness checks of SpscFifo2's in-place operations, quick enough to
+   run as a test: checkPeekSkip() walks peek() and skip() over every point
+   at which the readable items can wrap around the end of the ring, and
+   checkTransaction() and checkTransactionGroups() check that items pushed
+   through begin() are seen only once committed, and all together. Exits
+   with a failure, via the uncaught exception, on the first check that
+   doesn't hold. The two threads of checkTransactionGroups() run unpinned
+   unless CPUs are given as argv[1] and argv[2]. */
+
+static void expect(bool ok, char const* what) {
+	if (!ok) {
+		throw std::runtime_error(what);
+	}
+}
+
+/* Fills a ring of 8 with its first item at each slot in turn, so the items
+   wrap around the end of the buffer at every possible point, and checks
+   what peek() and skip() see. */
+static void checkPeekSkip() {
+	constexpr std::int64_t capacity = 8;
+	SpscFifo2<std::int64_t> q{capacity};
+
+	std::int64_t next = 0;
+	for (std::int64_t offset = 0; offset < capacity; ++offset) {
+		const std::int64_t first = next;
+		for (std::int64_t i = 0; i < capacity; ++i) {
+			expect(q.push(next++), "push() into a free slot failed");
+		}
+
+		for (std::int64_t k = 0; k < capacity; ++k) {
+			auto* item = q.peek(k);
+			expect(item != nullptr && *item == first + k, "peek(k) saw the wrong item");
+		}
+		expect(q.peek(capacity) == nullptr, "peek() past the last item");
+
+		expect(q.skip(3) == 3, "skip(3) of 8 items");
+		expect(*q.peek(0) == first + 3, "peek(0) after skip(3)");
+		expect(*q.peek(4) == first + 7, "peek(4) after skip(3)");
+		expect(q.peek(5) == nullptr, "peek() past the last item after skip(3)");
+
+		/* Note: Refill the 3 skipped slots, which lie across the wrap from
+		   the oldest item for most offsets. */
+		for (std::int64_t i = 0; i < 3; ++i) {
+			expect(q.push(next++), "push() into a skipped slot failed");
+		}
+		expect(*q.peek(capacity - 1) == first + capacity + 2, "peek() of a refilled slot");
+
+		expect(q.skip(capacity + 5) == capacity, "skip() more than there are");
+		expect(q.isEmpty() && q.skip(1) == 0 && q.peek(0) == nullptr, "empty after skip()");
+
+		/* Note: Move the next round's first item one slot on. */
+		std::int64_t item;
+		expect(q.push(next++) && q.pop(item), "push() and pop() to move on a slot");
+	}
+
+	std::cout << "peek()/skip() across the wrap: ok\n";
+}
+
+/* Counts its live instances, to tell whether abort() destroyed what it
+   had constructed. */
+struct Tracked {
+	static inline long live = 0;
+
+	std::int64_t value;
+
+	Tracked(std::int64_t v) : value{v} { ++live; }
+	Tracked(Tracked const& other) : value{other.value} { ++live; }
+	Tracked& operator=(Tracked const&) = default;
+	~Tracked() { --live; }
+};
+
+/* Single-threaded: what a transaction leaves visible, and alive, after
+   commit(), abort(), going out of scope open, and a begin() too large. */
+static void checkTransaction() {
+	SpscFifo2<Tracked> q{8};
+
+	{
+		auto tx = q.begin(3);
+		expect(static_cast<bool>(tx), "begin(3) on an empty queue failed");
+		tx.push(Tracked{1});
+		tx.push(Tracked{2});
+		expect(q.isEmpty() && q.peek(0) == nullptr, "uncommitted items are visible");
+
+		auto moved = std::move(tx);
+		expect(!tx, "moved-from transaction still open");
+		moved.commit();
+		expect(!moved, "committed transaction still open");
+	}
+	expect(q.getSize() == 2 && q.peek(1)->value == 2, "committed items not visible");
+
+	{
+		auto tx = q.begin(4);
+		tx.push(Tracked{3});
+		tx.push(Tracked{4});
+		tx.push(Tracked{5});
+		tx.abort();
+	}
+	expect(q.getSize() == 2 && q.peek(2) == nullptr, "aborted items are visible");
+	expect(Tracked::live == 2, "abort() left items alive");
+
+	{
+		auto tx = q.begin(2);
+		tx.push(Tracked{6});
+	}
+	expect(q.getSize() == 2 && Tracked::live == 2,
+		"transaction left open wasn't aborted");
+
+	expect(!q.begin(7), "begin() reserved more room than is free");
+
+	/* Note: With pop_pos_ moved on by 2, a full-size group wraps around the
+	   end of the ring. */
+	Tracked out{0};
+	expect(q.pop(out) && out.value == 1 && q.pop(out) && out.value == 2,
+		"pop() of committed items");
+	expect(!q.begin(9), "begin() reserved more than the capacity");
+	{
+		auto tx = q.begin(8);
+		for (std::int64_t i = 0; i < 8; ++i) {
+			tx.push(Tracked{10 + i});
+		}
+		expect(q.isEmpty(), "uncommitted items are visible across the wrap");
+		tx.commit();
+	}
+	expect(q.isFull() && q.peek(0)->value == 10 && q.peek(7)->value == 17,
+		"committed items across the wrap");
+	expect(q.skip(8) == 8 && Tracked::live == 1, "skip() of committed items");
+
+	std::cout << "Transaction commit()/abort(): ok\n";
+}
+
+/* One leg of a group pushed through a transaction. */
+struct Leg {
+	std::int64_t group;
+	std::int64_t index;
+	std::int64_t count;
+};
+
+/* Two threads: the Producer pushes groups of 1 to 7 legs, aborting every
+   fifth one part way through. Whenever the Consumer sees the first leg of a
+   group, the whole group must already be readable, and no leg of an
+   aborted group may ever show up.
+   Note: Waits by yielding rather than spinning, as this is a check rather
+   than a benchmark, and should finish quickly even on a single CPU. */
+static void checkTransactionGroups(long groups, int cpu1, int cpu2) {
+	SpscFifo2<Leg> q{64};
+
+	auto isAborted = [](std::int64_t group) { return group % 5 == 4; };
+	auto countOf = [](std::int64_t group) { return 1 + group % 7; };
+
+	auto t = std::jthread([&] {
+		pinThread(cpu1);
+		for (std::int64_t group = 0; group < groups; ++group) {
+			if (isAborted(group)) {
+				continue;
+			}
+
+			Leg const* head;
+			while ((head = q.peek(0)) == nullptr) {
+				std::this_thread::yield();
+			}
+			expect(head->group == group && head->index == 0,
+				"saw a leg of an aborted group, or out of order");
+
+			const std::int64_t count = countOf(group);
+			expect(head->count == count, "wrong group size");
+			for (std::int64_t i = 0; i < count; ++i) {
+				Leg const* leg = q.peek(static_cast<std::size_t>(i));
+				expect(leg != nullptr, "saw part of a group");
+				expect(leg->group == group && leg->index == i, "invalid leg");
+			}
+			q.skip(static_cast<std::size_t>(count));
+		}
+	});
+
+	pinThread(cpu2);
+	for (std::int64_t group = 0; group < groups; ++group) {
+		const std::int64_t count = countOf(group);
+		SpscFifo2<Leg>::Transaction tx;
+		while (!(tx = q.begin(static_cast<std::size_t>(count)))) {
+			std::this_thread::yield();
+		}
+		for (std::int64_t i = 0; i < count; ++i) {
+			tx.push(Leg{group, i, count});
+			if (isAborted(group) && i == count / 2) {
+				break;
+			}
+		}
+		if (isAborted(group)) {
+			tx.abort();
+		} else {
+			tx.commit();
+		}
+	}
+	t.join();
+
+	std::cout << "Transaction groups across threads: ok, " << groups << " groups\n";
+}
+
+int main(int argc, char* argv[]) {
+	int cpu1 = -1;
+	int cpu2 = -1;
+	if (argc == 3) {
+		cpu1 = std::atoi(argv[1]);
+		cpu2 = std::atoi(argv[2]);
+	}
+
+	constexpr auto groups = 1'000'000l;
+
+	checkPeekSkip();
+	checkTransaction();
+	checkTransactionGroups(groups, cpu1, cpu2);
+	return 0;
+}
@@ -0,0 +1,195 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <type_traits>
+
+#include "spsc_fifo_probes.hpp"
+
+/*
+	A thread-safe Single-Consumer, Single-Producer circular FIFO queue with a
+	compact, two-cache-line layout, for when there are many thousands of
+	mostly-idle queues.
+
+
+	SpscFifo2 gives each of its four position variables a cache line of its
+	own, plus a line of padding, so every instance is at least five lines (320
+	bytes) before a single slot is allocated. That's right for a handful of
+	hot queues, but with 20,000 per-session queues it's megabytes of padding,
+	almost all of it cold.
+
+	What actually matters for false-sharing is that the Producer's and the
+	Consumer's *writes* land on different lines. So here the control fields
+	are grouped by the thread that uses them:
+
+		line 0 (Producer): push_pos_, pop_pos_cached_, capacity, allocation
+		line 1 (Consumer): pop_pos_, push_pos_cached_, capacity, allocation
+
+	In the fast path each thread touches only its own line (which is why
+	capacity and allocation are duplicated) plus the slots. The other thread's
+	line is only read when the cached position runs out, exactly as in
+	SpscFifo2. The whole queue header is two lines: 128 bytes by default.
+
+	That grouping is the whole point, so CompactSpscFifo doesn't use
+	SpscFifo2's control block, SpscPositions, which gives every position a
+	line of its own. It does take the same InterferenceSize and TIndex
+	parameters, and fires the same USDT probes when it reloads a cached
+	position.
+
+	There's no padding after the Consumer's line, so the next object in memory
+	may be on the adjacent line. For a low-traffic queue that's a price worth
+	paying; for a hot queue, use SpscFifo2. To pack many queues and their
+	(small) rings densely, allocate them from a QueueSlab.
+*/
+
+/* Note: Optional allocator type for user-specified allocation policies.
+   Note: Optional size, in bytes, of each of the two lines, as in SpscFifo2.
+   With 128, the two threads' lines don't share an adjacent-line prefetch
+   pair either, at the cost of a 256-byte header.
+   Note: Optional type for the positions and capacity, as in SpscFifo2. With
+   std::uint32_t each line's three counters take 12 bytes rather than 24. */
+template<typename T, typename TAlloc = std::allocator<T>,
+	std::size_t InterferenceSize = 64,
+	typename TIndex = typename std::allocator_traits<TAlloc>::size_type>
+class CompactSpscFifo
+{
+public:
+	using allocator_traits = std::allocator_traits<TAlloc>;
+
+	/* Note: Wraps around exactly as SpscFifo2's positions do, so anything
+	   narrower than 64 bits needs a power-of-two capacity. */
+	using size_type = TIndex;
+	using value_type = T;
+
+	static_assert(std::is_unsigned_v<size_type> &&
+		sizeof(size_type) >= sizeof(unsigned),
+		"TIndex must be an unsigned type no narrower than unsigned int");
+
+	explicit CompactSpscFifo(size_type capacity, TAlloc const& alloc = TAlloc{})
+		: capacity_{capacity}
+		, alloc_{alloc}
+		, consumer_capacity_{capacity}
+	{
+		/* Note: Checked here, where the class is complete. */
+		static_assert(sizeof(CompactSpscFifo) == 2 * InterferenceSize,
+			"Each thread's control fields must fit in one InterferenceSize line");
+
+		assert(capacity > 0);
+		if constexpr (std::numeric_limits<size_type>::digits < 64)
+			assert((capacity & (capacity - 1)) == 0);
+		allocation_ = allocator_traits::allocate(alloc_, capacity_);
+		consumer_allocation_ = allocation_;
+	}
+
+	CompactSpscFifo(CompactSpscFifo const&) = delete;
+	CompactSpscFifo& operator=(CompactSpscFifo const&) = delete;
+	CompactSpscFifo(CompactSpscFifo&&) = delete;
+	CompactSpscFifo& operator=(CompactSpscFifo&&) = delete;
+
+	~CompactSpscFifo()
+	{
+		while (!isEmpty())
+		{
+			allocation_[pop_pos_ % capacity_].~T();
+			++pop_pos_;
+		}
+		allocator_traits::deallocate(alloc_, allocation_, capacity_);
+	}
+
+	size_type getCapacity() const noexcept { return capacity_; }
+
+	size_type getSize() const noexcept
+	{
+		const size_type push_pos = push_pos_.load(std::memory_order_relaxed);
+		const size_type pop_pos = pop_pos_.load(std::memory_order_relaxed);
+		return push_pos - pop_pos;
+	}
+
+	bool isEmpty() const noexcept { return getSize() == 0; }
+
+	bool isFull() const noexcept { return getSize() == capacity_; }
+
+	/* Note: Producer thread only. Touches only the Producer's line. */
+	bool push(T const& value)
+	{
+		/* Note: Use Relaxed operation ordering policy. */
+		const size_type push_pos = push_pos_.load(std::memory_order_relaxed);
+		if ((push_pos - pop_pos_cached_) == capacity_)
+		{
+			/* Note: Reading variable written to by other thread: Acquire! */
+			pop_pos_cached_ = pop_pos_.load(std::memory_order_acquire);
+			SPSC_FIFO_PROBE(push_refresh, this, push_pos, pop_pos_cached_);
+			if ((push_pos - pop_pos_cached_) == capacity_)
+			{
+				SPSC_FIFO_PROBE(push_full, this, push_pos, pop_pos_cached_);
+				return false;
+			}
+		}
+
+		new (&allocation_[push_pos % capacity_]) T(value);
+
+		/* Note: Writing variable read by other thread: Release! */
+		push_pos_.store(push_pos + 1, std::memory_order_release);
+
+		return true;
+	}
+
+	/* Note: Consumer thread only. Touches only the Consumer's line. */
+	bool pop(T& value)
+	{
+		/* Note: Use Relaxed operation ordering policy. */
+		const size_type pop_pos = pop_pos_.load(std::memory_order_relaxed);
+		if (push_pos_cached_ == pop_pos)
+		{
+			/* Note: Reading variable written to by other thread: Acquire! */
+			push_pos_cached_ = push_pos_.load(std::memory_order_acquire);
+			SPSC_FIFO_PROBE(pop_refresh, this, pop_pos, push_pos_cached_);
+			if (push_pos_cached_ == pop_pos)
+			{
+				SPSC_FIFO_PROBE(pop_empty, this, pop_pos, push_pos_cached_);
+				return false;
+			}
+		}
+
+		T& t = consumer_allocation_[pop_pos % consumer_capacity_];
+		value = t;
+		t.~T();
+
+		/* Note: Writing variable read by other thread: Release! */
+		pop_pos_.store(pop_pos + 1, std::memory_order_release);
+
+		return true;
+	}
+
+private:
+	using pos_type = std::atomic<size_type>;
+	static_assert(pos_type::is_always_lock_free);
+
+	/* Note: A template parameter rather than
+	   std::hardware_destructive_interference_size, as in SpscPositions. */
+	static_assert((InterferenceSize & (InterferenceSize - 1)) == 0,
+		"InterferenceSize must be a power of two");
+	static constexpr std::size_t hardware_destructive_interference_size =
+		InterferenceSize;
+
+	/* Producer's line. */
+	alignas(hardware_destructive_interference_size) pos_type push_pos_;
+	size_type pop_pos_cached_{};
+	size_type capacity_;
+	T*        allocation_;
+
+	/* Note: Only used on construction and destruction, so it can live on
+	   the Producer's line. [[no_unique_address]] (C++20) keeps an empty
+	   allocator from costing anything at all.
+	   See: https://en.cppreference.com/w/cpp/language/attributes/no_unique_address */
+	[[no_unique_address]] TAlloc alloc_;
+
+	/* Consumer's line. */
+	alignas(hardware_destructive_interference_size) pos_type pop_pos_;
+	size_type push_pos_cached_{};
+	size_type consumer_capacity_;
+	T*        consumer_allocation_;
+};
@@ -0,0 +1,178 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+
+#include "spsc_fifo_2.hpp"
+
+/*
+	A Single-Consumer, Single-Producer 'conflating' queue: only the latest
+	value for each key is ever delivered.
+
+
+	For per-instrument updates, the Consumer only cares about the newest value
+	for each symbol. With an ordinary FIFO it has to wade through every stale
+	intermediate update, and when it falls behind, the queue (and its latency)
+	grows without bound.
+
+	Here, values live in a flat table with one slot per key, and only *key ids*
+	go through an SpscFifo2:
+
+		- The Producer overwrites the key's slot, then pushes the key id - but
+		  only if the key isn't already pending (i.e. queued and not yet
+		  popped).
+		- The Consumer pops a key id, clears its pending flag and reads the
+		  latest value from the slot.
+
+	A key is in the queue at most once, so the queue never holds more than
+	'keys' entries, and the Consumer only ever sees the newest value.
+
+	Each slot is guarded by a sequence lock, since the Producer may overwrite
+	a value while the Consumer is reading it. The Producer bumps the slot's
+	sequence to odd, writes, and bumps it back to even; the Consumer retries
+	if it saw an odd sequence or the sequence changed under it. Slots are
+	cache-line aligned so neighbouring keys don't false-share.
+
+	Values are copied byte-wise under the sequence lock, so T must be
+	trivially copyable.
+
+	See: https://en.wikipedia.org/wiki/Seqlock
+*/
+
+template<typename T>
+class ConflatingFifo
+{
+	static_assert(std::is_trivially_copyable_v<T>,
+		"ConflatingFifo values must be trivially copyable");
+
+public:
+	using key_type = std::uint32_t;
+	using size_type = typename SpscFifo2<key_type>::size_type;
+	using value_type = T;
+
+	explicit ConflatingFifo(size_type keys)
+		: keys_{keys}
+		, slots_{std::make_unique<Slot[]>(keys)}
+		, queue_{keys}
+	{}
+
+	ConflatingFifo(ConflatingFifo const&) = delete;
+	ConflatingFifo& operator=(ConflatingFifo const&) = delete;
+	ConflatingFifo(ConflatingFifo&&) = delete;
+	ConflatingFifo& operator=(ConflatingFifo&&) = delete;
+
+	size_type getKeyCount() const noexcept { return keys_; }
+
+	/* Number of keys with an update waiting. Never more than the key count. */
+	size_type getSize() const noexcept { return queue_.getSize(); }
+
+	bool isEmpty() const noexcept { return queue_.isEmpty(); }
+
+	/* Number of updates that replaced a not-yet-consumed value.
+	   Note: Producer thread only. */
+	std::uint64_t getConflatedCount() const noexcept { return conflated_; }
+
+	/* Sets the latest value for 'key'. Never fails: the queue holds at most
+	   one entry per key, so there's always room.
+	   Note: Producer thread only. */
+	void push(key_type key, T const& value)
+	{
+		assert(key < keys_);
+		Slot& slot = slots_[key];
+
+		/* Note: Sequence lock write. The odd sequence must be visible before
+		   any of the new bytes, hence the Release fence after it. */
+		const std::uint32_t seq = slot.seq.load(std::memory_order_relaxed);
+		slot.seq.store(seq + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		storeBytes(slot, value);
+		slot.seq.store(seq + 2, std::memory_order_release);
+
+		/* Note: Only the Producer sets the flag, and only the Consumer clears
+		   it. If it was already set, the key is queued and the Consumer will
+		   read the value we just wrote. That takes a store-load barrier on
+		   each side - this fence, and the one in pop() - or the Consumer
+		   could clear the flag and still read the old value while we see
+		   the flag set and skip the push. */
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (slot.pending.exchange(true, std::memory_order_relaxed))
+		{
+			++conflated_;
+			return;
+		}
+
+		const bool pushed = queue_.push(key);
+		assert(pushed);
+		(void)pushed;
+	}
+
+	/* Pops the next key with an update and reads its latest value. Returns
+	   false if no key has an update waiting.
+	   Note: Consumer thread only. */
+	bool pop(key_type& key, T& value)
+	{
+		if (!queue_.pop(key))
+			return false;
+
+		Slot& slot = slots_[key];
+
+		/* Note: Clear the flag *before* reading the value. A push() that
+		   lands after this point queues the key again, so it can't be lost;
+		   at worst we deliver the newer value now and again later. */
+		slot.pending.store(false, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+
+		for (;;)
+		{
+			const std::uint32_t before = slot.seq.load(std::memory_order_acquire);
+			if (before & 1)
+				continue;
+			loadBytes(slot, value);
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (slot.seq.load(std::memory_order_relaxed) == before)
+				return true;
+		}
+	}
+
+private:
+	/* Note: The value is held as relaxed atomic words, so the racy copy a
+	   sequence lock relies on is still well-defined C++. */
+	using word_type = std::uint64_t;
+	static constexpr std::size_t value_words =
+		(sizeof(T) + sizeof(word_type) - 1) / sizeof(word_type);
+
+	struct alignas(64) Slot
+	{
+		std::atomic<std::uint32_t> seq{};
+		std::atomic<bool>          pending{};
+		std::atomic<word_type>     words[value_words]{};
+	};
+
+	static void storeBytes(Slot& slot, T const& value) noexcept
+	{
+		word_type words[value_words]{};
+		std::memcpy(words, &value, sizeof(T));
+		for (std::size_t i = 0; i < value_words; ++i)
+			slot.words[i].store(words[i], std::memory_order_relaxed);
+	}
+
+	static void loadBytes(Slot const& slot, T& value) noexcept
+	{
+		word_type words[value_words];
+		for (std::size_t i = 0; i < value_words; ++i)
+			words[i] = slot.words[i].load(std::memory_order_relaxed);
+		std::memcpy(&value, words, sizeof(T));
+	}
+
+	size_type               keys_;
+	std::unique_ptr<Slot[]> slots_;
+	SpscFifo2<key_type>     queue_;
+
+	/* Exclusive to Producer thread. */
+	std::uint64_t           conflated_{};
+};
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+#include "spsc_fifo_2.hpp"
+#include "timestamp_member.hpp"
+
+/*
+	A thread-safe Single-Consumer, Single-Producer FIFO of timestamped items
+	which silently drops items older than a maximum age.
+
+
+	When messages are useless after N microseconds, a Consumer coming back
+	from a stall doesn't want to pop its way through a ring full of expired
+	items one at a time before it reaches live ones. But the Producer stamps
+	items in order, so the timestamps in the readable region are monotonic and
+	'expired' is true for a prefix of the queue and false after it. The
+	Consumer can find the end of that prefix with a binary search and drop the
+	whole run with a single store to pop_pos_ - see
+	`SpscFifo2::discardWhile()`.
+
+	pop() first peeks the head. Only if the head has expired does it do the
+	binary search, so while the Consumer keeps up, the cost over a plain
+	SpscFifo2 is one timestamp comparison per pop.
+
+	'now' is passed in by the caller, so the timestamps can come from any
+	clock - a `std::chrono` time_point, or plain integer nanoseconds - as long
+	as `timestamp - timestamp` gives something comparable with the maximum
+	age.
+*/
+
+template<typename T, typename TGetTimestamp = TimestampMember>
+class DeadlineFifo : private TGetTimestamp
+{
+public:
+	using fifo_type = SpscFifo2<T>;
+	using size_type = typename fifo_type::size_type;
+	using value_type = T;
+	using timestamp_type =
+		std::decay_t<std::invoke_result_t<TGetTimestamp, T const&>>;
+	using duration_type =
+		decltype(std::declval<timestamp_type>() - std::declval<timestamp_type>());
+
+	DeadlineFifo(size_type capacity, duration_type maxAge,
+		TGetTimestamp const& getTimestamp = {})
+		: TGetTimestamp{getTimestamp}
+		, fifo_{capacity}
+		, max_age_{maxAge}
+	{}
+
+	DeadlineFifo(DeadlineFifo const&) = delete;
+	DeadlineFifo& operator=(DeadlineFifo const&) = delete;
+	DeadlineFifo(DeadlineFifo&&) = delete;
+	DeadlineFifo& operator=(DeadlineFifo&&) = delete;
+
+	size_type getCapacity() const noexcept { return fifo_.getCapacity(); }
+
+	size_type getSize() const noexcept { return fifo_.getSize(); }
+
+	bool isEmpty() const noexcept { return fifo_.isEmpty(); }
+
+	duration_type getMaxAge() const noexcept { return max_age_; }
+
+	/* Number of expired items dropped so far.
+	   Note: Consumer thread only. */
+	std::uint64_t getDropCount() const noexcept { return dropped_; }
+
+	/* Note: Timestamps must not decrease from one push() to the next.
+	   Producer thread only. */
+	bool push(T const& value) { return fifo_.push(value); }
+
+	/* Pops the oldest item which hasn't expired as of 'now', dropping any
+	   older ones. Returns false if there's no such item.
+	   Note: Consumer thread only. */
+	bool pop(T& value, timestamp_type now)
+	{
+		T* head = fifo_.front();
+		if (head == nullptr)
+			return false;
+
+		if (isExpired(*head, now))
+		{
+			dropped_ += fifo_.discardWhile([this, now](T const& item) {
+				return isExpired(item, now);
+			});
+		}
+
+		return fifo_.pop(value);
+	}
+
+private:
+	bool isExpired(T const& item, timestamp_type now) const
+	{
+		return now - TGetTimestamp::operator()(item) > max_age_;
+	}
+
+	fifo_type     fifo_;
+	duration_type max_age_;
+
+	/* Exclusive to Consumer thread. */
+	std::uint64_t dropped_{};
+};
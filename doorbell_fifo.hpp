@@ -0,0 +1,138 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+/*
+	A thread-safe Single-Consumer, Single-Producer circular FIFO queue of a
+	handful of small values, packed into a single cache line.
+
+
+	For control signalling - "wake up", "reload config", a few small integers
+	at a time - an SpscFifo2 of capacity 4-8 is mostly overhead: four
+	position lines, a padding line and a separately allocated buffer, so a
+	push() and the pop() that follows it touch several lines between them.
+
+	Here everything lives in one cache line (two at most): both positions
+	first, then the slots. A push() or pop() touches that line and nothing
+	else, so a signal costs a single line transfer between the cores. The
+	Producer's and the Consumer's writes do share that line, but with a
+	handful of slots the data itself would bounce the line anyway, so
+	SpscFifo2's separate, cached positions buy nothing here.
+
+	The positions count modulo 2 * Capacity rather than free-running. That
+	keeps them in 16 bits, and lets Capacity be any size, not only a power of
+	two, while still telling a full queue (positions a lap apart) from an
+	empty one (positions equal).
+
+	By default Capacity is as many slots as fit alongside the positions in one
+	line - 15 `std::uint32_t`s, or 30 `std::uint16_t`s. A larger Capacity may
+	spill into a second line, but no further. T must be trivially
+	copyable, since the slots are plain values rather than raw storage.
+*/
+
+template<typename T, std::size_t Capacity = (64 - 2 * sizeof(std::uint16_t)) / sizeof(T)>
+class alignas(64) DoorbellFifo
+{
+	static_assert(std::is_trivially_copyable_v<T>,
+		"DoorbellFifo values must be trivially copyable");
+	static_assert(Capacity > 0);
+
+public:
+	using size_type = std::size_t;
+	using value_type = T;
+
+	DoorbellFifo() noexcept
+	{
+		/* Note: Checked on the whole object, as the class is only complete
+		   in here, so any padding between the positions and the slots
+		   counts too. */
+		static_assert(sizeof(DoorbellFifo) <= 128,
+			"A DoorbellFifo is at most two cache lines - use SpscFifo2 instead");
+	}
+
+	DoorbellFifo(DoorbellFifo const&) = delete;
+	DoorbellFifo& operator=(DoorbellFifo const&) = delete;
+	DoorbellFifo(DoorbellFifo&&) = delete;
+	DoorbellFifo& operator=(DoorbellFifo&&) = delete;
+
+	static constexpr size_type getCapacity() noexcept { return Capacity; }
+
+	size_type getSize() const noexcept
+	{
+		return distance(push_pos_.load(std::memory_order_relaxed),
+			pop_pos_.load(std::memory_order_relaxed));
+	}
+
+	bool isEmpty() const noexcept { return getSize() == 0; }
+
+	bool isFull() const noexcept { return getSize() == Capacity; }
+
+	/* Note: Producer thread only. */
+	bool push(T const& value) noexcept
+	{
+		/* Note: Use Relaxed operation ordering policy. */
+		const pos_type push_pos = push_pos_.load(std::memory_order_relaxed);
+
+		/* Note: Reading variable written to by other thread: Acquire! */
+		const pos_type pop_pos = pop_pos_.load(std::memory_order_acquire);
+		if (distance(push_pos, pop_pos) == Capacity)
+			return false;
+
+		slots_[toIndex(push_pos)] = value;
+
+		/* Note: Writing variable read by other thread: Release! */
+		push_pos_.store(next(push_pos), std::memory_order_release);
+
+		return true;
+	}
+
+	/* Note: Consumer thread only. */
+	bool pop(T& value) noexcept
+	{
+		/* Note: Reading variable written to by other thread: Acquire! */
+		const pos_type push_pos = push_pos_.load(std::memory_order_acquire);
+
+		/* Note: Use Relaxed operation ordering policy. */
+		const pos_type pop_pos = pop_pos_.load(std::memory_order_relaxed);
+		if (push_pos == pop_pos)
+			return false;
+
+		value = slots_[toIndex(pop_pos)];
+
+		/* Note: Writing variable read by other thread: Release! */
+		pop_pos_.store(next(pop_pos), std::memory_order_release);
+
+		return true;
+	}
+
+private:
+	using pos_type = std::uint16_t;
+	static_assert(std::atomic<pos_type>::is_always_lock_free);
+
+	static constexpr pos_type laps = static_cast<pos_type>(2 * Capacity);
+
+	/* Note: Positions are in [0, 2 * Capacity), so their difference is too. */
+	static constexpr size_type distance(pos_type push_pos, pos_type pop_pos) noexcept
+	{
+		return push_pos >= pop_pos
+			? size_type(push_pos - pop_pos)
+			: size_type(push_pos + laps - pop_pos);
+	}
+
+	static constexpr size_type toIndex(pos_type pos) noexcept
+	{
+		return pos >= Capacity ? pos - Capacity : pos;
+	}
+
+	static constexpr pos_type next(pos_type pos) noexcept
+	{
+		return pos + 1 == laps ? pos_type{0} : static_cast<pos_type>(pos + 1);
+	}
+
+	std::atomic<pos_type> push_pos_{};
+	std::atomic<pos_type> pop_pos_{};
+	T                     slots_[Capacity]{};
+};
@@ -0,0 +1,258 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <vector>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "spsc_positions.hpp"
+
+/*
+	A thread-safe Single-Consumer, Single-Producer circular FIFO queue which
+	gives the memory of idle parts of its ring back to the OS.
+
+
+	A queue sized for the worst burst spends most of its life nearly empty,
+	but every page of its ring that was ever written stays resident. With
+	many such queues that adds up to hundreds of megabytes doing nothing.
+
+	Here the ring is mmap()'d directly, page-aligned, and `trim()` calls
+	madvise() on the pages which are:
+
+		- free: every byte lies in the region between the push position and
+		  the pop position + capacity, which holds no items, and
+		- idle: the Producer hasn't entered the page for at least the
+		  configured idle period.
+
+	With MADV_DONTNEED (the default) the pages leave the RSS straight away and
+	come back zero-filled on the next write. With MADV_FREE the kernel only
+	takes them under memory pressure, which is cheaper if they're reused soon.
+
+	Only the Producer ever writes to the free region, and the Consumer never
+	reads it, so it's the Producer which calls `trim()` - e.g. from its idle
+	loop. No handshake with the Consumer is needed: the pop position only moves
+	forward, so a page which is free when trim() Acquires it stays free until
+	the Producer itself writes there.
+
+	To keep page faults off the push() path, each time the Producer enters a
+	new page it first touches the next `prefaultPages` pages, so that a
+	released page is faulted back in a little ahead of when it's needed.
+	Apart from that page-crossing check, push() and pop() are the same as
+	SpscFifo2's, down to its control block, SpscPositions, and so its
+	InterferenceSize and TIndex parameters. The page bookkeeping is in bytes,
+	and so always std::size_t.
+*/
+
+template<typename T, std::size_t InterferenceSize = 64,
+	typename TIndex = std::size_t>
+class ElasticSpscFifo
+{
+public:
+	using positions_type = SpscPositions<TIndex, InterferenceSize>;
+	using size_type = typename positions_type::size_type;
+	using value_type = T;
+	using clock_type = std::chrono::steady_clock;
+
+	struct Config
+	{
+		/* How long a page must go without the Producer entering it before
+		   trim() releases it. */
+		clock_type::duration idlePeriod = std::chrono::seconds{1};
+
+		/* MADV_DONTNEED or MADV_FREE. */
+		int advice = MADV_DONTNEED;
+
+		/* Pages to fault in ahead of the Producer. */
+		std::size_t prefaultPages = 1;
+	};
+
+	explicit ElasticSpscFifo(size_type capacity, Config const& config = Config{})
+		: capacity_{capacity}
+		, config_{config}
+		, page_size_{static_cast<std::size_t>(::sysconf(_SC_PAGESIZE))}
+		, page_shift_{static_cast<std::size_t>(std::countr_zero(page_size_))}
+		, bytes_{(capacity * sizeof(T) + page_size_ - 1) / page_size_ * page_size_}
+		, page_count_{bytes_ / page_size_}
+		, entered_(page_count_, clock_type::now())
+		, released_(page_count_, false)
+		, positions_{capacity}
+	{
+		static_assert(alignof(T) <= alignof(std::max_align_t));
+
+		void* p = ::mmap(nullptr, bytes_, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (p == MAP_FAILED)
+			throw std::bad_alloc{};
+		allocation_ = static_cast<T*>(p);
+	}
+
+	ElasticSpscFifo(ElasticSpscFifo const&) = delete;
+	ElasticSpscFifo& operator=(ElasticSpscFifo const&) = delete;
+	ElasticSpscFifo(ElasticSpscFifo&&) = delete;
+	ElasticSpscFifo& operator=(ElasticSpscFifo&&) = delete;
+
+	~ElasticSpscFifo()
+	{
+		const size_type push_pos = positions_.getPushPos();
+		for (size_type pop_pos = positions_.getPopPos(); pop_pos != push_pos; ++pop_pos)
+			allocation_[pop_pos % capacity_].~T();
+		::munmap(allocation_, bytes_);
+	}
+
+	size_type getCapacity() const noexcept { return capacity_; }
+
+	size_type getSize() const noexcept { return positions_.getSize(); }
+
+	bool isEmpty() const noexcept { return positions_.isEmpty(); }
+
+	bool isFull() const noexcept { return positions_.isFull(); }
+
+	/* Total number of pages given back to the OS by trim() so far.
+	   Note: Producer thread only. */
+	std::size_t getReleasedCount() const noexcept { return released_count_; }
+
+	/* Note: Producer thread only. */
+	bool push(T const& value)
+	{
+		const size_type push_pos = positions_.getPushPos();
+		if (positions_.getWritable(push_pos) == 0)
+			return false;
+
+		/* Note: The page holding the last byte of the slot. Usually the same
+		   as last time, so this is one shift and one compare. */
+		const size_type index = push_pos % capacity_;
+		const std::size_t offset = std::size_t{index} * sizeof(T);
+		const std::size_t page = (offset + sizeof(T) - 1) >> page_shift_;
+		if (page != producer_page_)
+			enterPage(offset >> page_shift_, page);
+
+		new (&allocation_[index]) T(value);
+
+		positions_.publishPush(push_pos + 1);
+
+		return true;
+	}
+
+	/* Note: Consumer thread only. */
+	bool pop(T& value)
+	{
+		const size_type pop_pos = positions_.getPopPos();
+		if (positions_.getReadable(pop_pos) == 0)
+			return false;
+
+		T& t = allocation_[pop_pos % capacity_];
+		value = t;
+		t.~T();
+
+		positions_.publishPop(pop_pos + 1);
+
+		return true;
+	}
+
+	/* Gives back to the OS every page which is free and hasn't been entered
+	   for the idle period, and returns how many pages that was.
+	   Note: Producer thread only. */
+	std::size_t trim(clock_type::time_point now = clock_type::now())
+	{
+		/* Note: Always re-Acquires the pop position, as trim() runs when the
+		   Producer is idle and its cached copy is likely stale. */
+		const size_type push_pos = positions_.getPushPos();
+		const size_type free = positions_.getWritable(push_pos,
+			positions_type::all, 0);
+		if (free == 0)
+			return 0;
+
+		/* Note: The free slots [push_pos, pop_pos + capacity) are at most two
+		   contiguous runs of the buffer. */
+		const size_type first = push_pos % capacity_;
+		const size_type firstCount = std::min(free,
+			static_cast<size_type>(capacity_ - first));
+		std::size_t released = trimRange(first, firstCount, now);
+		if (firstCount < free)
+			released += trimRange(0, free - firstCount, now);
+
+		released_count_ += released;
+		return released;
+	}
+
+private:
+	/* Releases the idle pages lying entirely inside the slots
+	   [index, index + count). */
+	std::size_t trimRange(size_type index, size_type count,
+		clock_type::time_point now)
+	{
+		const std::size_t begin = std::size_t{index} * sizeof(T);
+		std::size_t end = std::size_t{index + count} * sizeof(T);
+		/* Note: The tail of the last page holds no slots, so it's free
+		   whenever the last slot is. */
+		if (index + count == capacity_)
+			end = bytes_;
+
+		std::size_t released = 0;
+		for (std::size_t page = (begin + page_size_ - 1) / page_size_;
+			(page + 1) * page_size_ <= end; ++page)
+		{
+			if (released_[page] || now - entered_[page] < config_.idlePeriod)
+				continue;
+			::madvise(reinterpret_cast<std::byte*>(allocation_) + page * page_size_,
+				page_size_, config_.advice);
+			released_[page] = true;
+			/* Note: The next push() may land on this page again, so make it
+			   go through enterPage(). */
+			if (page == producer_page_)
+				producer_page_ = ~std::size_t{};
+			++released;
+		}
+		return released;
+	}
+
+	/* Note: A slot may straddle two pages, [first, page]. */
+	void enterPage(std::size_t first, std::size_t page)
+	{
+		producer_page_ = page;
+		const clock_type::time_point now = clock_type::now();
+		for (std::size_t p = first; p <= page; ++p)
+		{
+			entered_[p] = now;
+			released_[p] = false;
+		}
+
+		/* Note: The pages ahead are free - the Consumer isn't reading them -
+		   so writing a byte to each is enough to fault it back in now rather
+		   than in a later push(). */
+		for (std::size_t i = 1; i <= config_.prefaultPages && i < page_count_; ++i)
+		{
+			const std::size_t ahead = (page + i) % page_count_;
+			if (!released_[ahead])
+				continue;
+			auto* byte = reinterpret_cast<std::byte volatile*>(allocation_)
+				+ ahead * page_size_;
+			*byte = std::byte{0};
+			entered_[ahead] = now;
+			released_[ahead] = false;
+		}
+	}
+
+	size_type   capacity_;    /* Maximum number of items */
+	Config      config_;
+	std::size_t page_size_;
+	std::size_t page_shift_;  /* log2(page_size_) */
+	std::size_t bytes_;       /* Size of the mapping: capacity rounded up to pages */
+	std::size_t page_count_;
+	T*          allocation_;
+
+	/* Exclusive to Producer thread. One entry per page. */
+	std::vector<clock_type::time_point> entered_;
+	std::vector<bool>                   released_;
+	std::size_t                         producer_page_{~std::size_t{}};
+	std::size_t                         released_count_{};
+
+	positions_type positions_;
+};
@@ -0,0 +1,230 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "spsc_fifo_2.hpp"
+#include "timestamp_member.hpp"
+
+/*
+	A K-way, timestamp-ordered merge of several SPSC queues.
+
+
+	Each input has its own Producer (e.g. one exchange feed per thread) pushing
+	into its own SpscFifo2, and a single Consumer merges all inputs into one
+	stream ordered by timestamp. The Consumer never pops speculatively: it
+	peeks at the head of each input with `SpscFifo2::front()` and keeps a
+	min-heap of (head timestamp, input index). The top of the heap is the next
+	item in global order - provided every other input that might still produce
+	something earlier already has a head to compare against.
+
+	That proviso is the hard part. An input that is empty but still live could
+	be about to deliver an item older than anything we're holding, so strictly
+	we'd have to wait on it forever. Instead, the wait is bounded by a
+	configurable lateness: once every empty input has been empty for longer
+	than the bound, the Consumer emits the best head it has. An input's clock
+	starts when it's first found empty and only restarts after it has
+	delivered a head, so a backlog held up by an idle input drains at full
+	speed once the bound has expired, rather than waiting out the bound again
+	for every item. If an input later delivers an item older than one already
+	emitted, that item is still emitted (nothing is dropped), but it's
+	counted in `getLateCount()`.
+
+	Inputs which have finished for good should be `close()`d by their Producer.
+	A closed, empty input no longer holds up the merge at all.
+
+	Each pop() costs O(log K) for the heap, plus a front() poll of each input
+	that was empty last time - so idle inputs cost a relaxed load per pop and
+	only an acquire when their Producer has actually pushed something. Only
+	while some input is empty does a pop() also read the clock.
+*/
+
+template<typename T, typename TGetTimestamp = TimestampMember>
+class MergeFifo : private TGetTimestamp
+{
+public:
+	using input_type = SpscFifo2<T>;
+	using size_type = typename input_type::size_type;
+	using value_type = T;
+	using timestamp_type =
+		std::decay_t<std::invoke_result_t<TGetTimestamp, T const&>>;
+	using clock = std::chrono::steady_clock;
+
+	MergeFifo(size_type inputs, size_type inputCapacity,
+		clock::duration lateness, TGetTimestamp const& getTimestamp = {})
+		: TGetTimestamp{getTimestamp}
+		, closed_(inputs)
+		, lateness_{lateness}
+	{
+		assert(inputs > 0);
+		/* Note: SpscFifo2 can't be moved, so each input lives on the heap
+		   behind a unique_ptr. */
+		inputs_.reserve(inputs);
+		for (size_type i = 0; i < inputs; ++i)
+		{
+			inputs_.push_back(std::make_unique<input_type>(inputCapacity));
+			empty_.push_back(EmptyInput{i, unstamped});
+		}
+		heap_.reserve(inputs);
+	}
+
+	MergeFifo(MergeFifo const&) = delete;
+	MergeFifo& operator=(MergeFifo const&) = delete;
+	MergeFifo(MergeFifo&&) = delete;
+	MergeFifo& operator=(MergeFifo&&) = delete;
+
+	size_type getInputCount() const noexcept { return inputs_.size(); }
+
+	/* The queue Producer 'i' pushes into. */
+	input_type& getInput(size_type i) noexcept { return *inputs_[i]; }
+
+	/* Marks input 'i' as finished. No more pushes may follow.
+	   Note: Producer 'i' thread only. */
+	void close(size_type i) noexcept
+	{
+		/* Note: Release, so that every push() before the close is visible
+		   to the Consumer once it sees the flag. */
+		closed_[i].store(true, std::memory_order_release);
+	}
+
+	/* Pops the next item in timestamp order. Returns false if nothing can be
+	   emitted yet, i.e. all inputs are empty, or a live input is empty and
+	   the lateness bound hasn't expired.
+	   Note: Consumer thread only. */
+	bool pop(T& value)
+	{
+		pollEmptyInputs();
+
+		if (heap_.empty())
+			return false;
+
+		if (!empty_.empty())
+		{
+			/* Note: Some live input has no head to compare against. Only
+			   read the clock when we're actually blocked, so the common case
+			   of every input having a head stays clock-free. */
+			const auto now = clock::now();
+			if (now - stampEmptyInputs(now) < lateness_)
+				return false;
+		}
+
+		std::pop_heap(heap_.begin(), heap_.end(), HeadGreater{});
+		const auto [timestamp, i] = heap_.back();
+		heap_.pop_back();
+
+		const bool popped = inputs_[i]->pop(value);
+		assert(popped);
+		(void)popped;
+
+		if (has_emitted_ && timestamp < last_timestamp_)
+			++late_count_;
+		else
+			last_timestamp_ = timestamp;
+		has_emitted_ = true;
+
+		if (!pushHead(i))
+			empty_.push_back(EmptyInput{i, unstamped});
+
+		return true;
+	}
+
+	/* True once every input is closed and drained.
+	   Note: Consumer thread only. */
+	bool isDone()
+	{
+		pollEmptyInputs();
+		return heap_.empty() && empty_.empty();
+	}
+
+	/* Number of items emitted after a newer item had already been emitted. */
+	std::uint64_t getLateCount() const noexcept { return late_count_; }
+
+private:
+	using head_type = std::pair<timestamp_type, size_type>;
+
+	/* A live input with no head, and when it was first found empty. */
+	struct EmptyInput
+	{
+		size_type         input;
+		clock::time_point since;
+	};
+
+	/* Note: 'since' of an input which went empty after the clock was last
+	   read. */
+	static constexpr clock::time_point unstamped = clock::time_point::min();
+
+	struct HeadGreater
+	{
+		bool operator()(head_type const& a, head_type const& b) const noexcept
+		{
+			return a.first > b.first;
+		}
+	};
+
+	/* Peeks input 'i' and, if it has a head, adds it to the heap. */
+	bool pushHead(size_type i)
+	{
+		T const* head = inputs_[i]->front();
+		if (head == nullptr)
+			return false;
+		heap_.emplace_back(TGetTimestamp::operator()(*head), i);
+		std::push_heap(heap_.begin(), heap_.end(), HeadGreater{});
+		return true;
+	}
+
+	/* Re-checks every input that was empty last time. Inputs which are
+	   closed and still empty are retired for good. */
+	void pollEmptyInputs()
+	{
+		for (size_type n = 0; n < empty_.size();)
+		{
+			const size_type i = empty_[n].input;
+			/* Note: Read the flag *before* peeking, so a close() that raced
+			   with a final push() can't make us retire a non-empty input. */
+			const bool closed = closed_[i].load(std::memory_order_acquire);
+			if (pushHead(i) || closed)
+			{
+				empty_[n] = empty_.back();
+				empty_.pop_back();
+			}
+			else
+			{
+				++n;
+			}
+		}
+	}
+
+	/* Stamps the inputs which went empty since the clock was last read with
+	   'now', and returns when the most recently emptied input was first found
+	   empty: the merge is blocked until that one, too, has been idle for the
+	   lateness bound. */
+	clock::time_point stampEmptyInputs(clock::time_point now) noexcept
+	{
+		clock::time_point since = clock::time_point::min();
+		for (EmptyInput& empty : empty_)
+		{
+			if (empty.since == unstamped)
+				empty.since = now;
+			since = std::max(since, empty.since);
+		}
+		return since;
+	}
+
+	std::vector<std::unique_ptr<input_type>> inputs_;
+	std::vector<std::atomic<bool>>           closed_;
+
+	/* Everything below is exclusive to the Consumer thread. */
+	clock::duration         lateness_;
+	std::vector<head_type>  heap_;   /* Inputs with a head, min-heap on timestamp */
+	std::vector<EmptyInput> empty_;  /* Live inputs with no head */
+	bool                    has_emitted_{};
+	timestamp_type          last_timestamp_{};
+	std::uint64_t           late_count_{};
+};
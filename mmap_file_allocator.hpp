@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cerrno>
+#include <cstddef>
+#include <filesystem>
+#include <string>
+#include <system_error>
+#include <type_traits>
+
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+/*
+	An allocator whose memory is a file mapped with mmap().
+
+
+	Every allocation creates its own temporary file in 'directory', unlinks it
+	straight away (so it disappears with the process, however the process
+	ends), sizes it with ftruncate() and maps it shared. The file is sparse:
+	disk blocks are only allocated for pages that are actually written, and
+	the kernel is free to write dirty pages back and drop them from memory. So
+	a huge allocation costs address space, not RAM, until it's used.
+
+	Being a plain allocator, it plugs straight into the allocator parameter of
+	any of our FIFOs, e.g. `SpscFifo2<T, MmapFileAllocator<T>>`. Only trivially
+	copyable types make sense in file-backed memory.
+*/
+
+template<typename T>
+class MmapFileAllocator
+{
+public:
+	using value_type = T;
+
+	/* Note: Defaults to the system's temporary directory, e.g. /tmp. */
+	explicit MmapFileAllocator(std::string directory =
+		std::filesystem::temp_directory_path().string())
+		: directory_{std::move(directory)}
+	{}
+
+	template<typename U>
+	MmapFileAllocator(MmapFileAllocator<U> const& other)
+		: directory_{other.getDirectory()}
+	{}
+
+	std::string const& getDirectory() const noexcept { return directory_; }
+
+	T* allocate(std::size_t n)
+	{
+		std::string path = directory_ + "/spsc_fifo.XXXXXX";
+		const int fd = ::mkstemp(path.data());
+		if (fd == -1)
+			throw std::system_error(errno, std::generic_category(), "mkstemp");
+		::unlink(path.c_str());
+
+		const std::size_t bytes = n * sizeof(T);
+		if (::ftruncate(fd, static_cast<off_t>(bytes)) == -1)
+		{
+			const int error = errno;
+			::close(fd);
+			throw std::system_error(error, std::generic_category(), "ftruncate");
+		}
+
+		void* p = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED,
+			fd, 0);
+		const int error = errno;
+
+		/* Note: The mapping keeps the file alive; we don't need the fd. */
+		::close(fd);
+		if (p == MAP_FAILED)
+			throw std::system_error(error, std::generic_category(), "mmap");
+		return static_cast<T*>(p);
+	}
+
+	void deallocate(T* p, std::size_t n) noexcept
+	{
+		::munmap(p, n * sizeof(T));
+	}
+
+	template<typename U>
+	bool operator==(MmapFileAllocator<U> const& other) const noexcept
+	{
+		return directory_ == other.getDirectory();
+	}
+
+private:
+	std::string directory_;
+};
@@ -0,0 +1,214 @@
+#pragma once
+
+#include <climits>
+#include <cstddef>
+#include <fstream>
+#include <memory>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/*
+	NUMA-aware placement of queue buffers and queues, without libnuma.
+
+
+	On a multi-socket machine, a ring on the far node costs a cross-socket
+	trip for every cache line the near thread misses on. The Consumer misses
+	on every slot it reads, so the slots usually belong on the Consumer's
+	node; the control lines are read by both sides, so either node will do
+	as long as it's deliberate.
+
+	Here:
+
+		- The topology comes from sysfs: /sys/devices/system/node/online for
+		  the nodes, and each node's cpulist for its CPUs.
+		- Memory is mmap()'d, then bound to a node with the raw mbind(2)
+		  system call (MPOL_BIND, as numa_alloc_onnode() does) before anything
+		  touches it, so no libnuma or <numaif.h> is needed.
+		- NumaAllocator plugs into any of our FIFOs' allocator parameter to
+		  place the slots, and makeOnNumaNode() places a whole queue object -
+		  its control lines - the same way.
+
+	Everything falls back cleanly: with one node, no sysfs, or an mbind()
+	which the kernel refuses (no NUMA support, or a seccomp filter), the
+	memory is simply left to the default first-touch policy.
+
+	See: https://man7.org/linux/man-pages/man2/mbind.2.html
+*/
+
+/* Parses a sysfs list such as "0-3,8,10-11". */
+inline std::vector<int> parseNumaList(std::string const& list)
+{
+	std::vector<int> values;
+	std::size_t pos = 0;
+	while (pos < list.size())
+	{
+		std::size_t end = list.find(',', pos);
+		if (end == std::string::npos)
+			end = list.size();
+		const std::string range = list.substr(pos, end - pos);
+		const std::size_t dash = range.find('-');
+		try
+		{
+			const int first = std::stoi(range.substr(0, dash));
+			const int last = dash == std::string::npos
+				? first : std::stoi(range.substr(dash + 1));
+			for (int value = first; value <= last; ++value)
+				values.push_back(value);
+		}
+		catch (...)
+		{
+			/* Note: Ignore anything malformed, e.g. a trailing newline. */
+		}
+		pos = end + 1;
+	}
+	return values;
+}
+
+/* The online NUMA nodes. Just {0} if sysfs doesn't say. */
+inline std::vector<int> getNumaNodes()
+{
+	std::string list;
+	std::ifstream{"/sys/devices/system/node/online"} >> list;
+	std::vector<int> nodes = parseNumaList(list);
+	if (nodes.empty())
+		nodes.push_back(0);
+	return nodes;
+}
+
+/* The node 'cpu' belongs to, or 0 if it can't be found. */
+inline int getNumaNodeOfCpu(int cpu)
+{
+	for (int node : getNumaNodes())
+	{
+		std::string list;
+		std::ifstream{"/sys/devices/system/node/node" + std::to_string(node) +
+			"/cpulist"} >> list;
+		for (int c : parseNumaList(list))
+		{
+			if (c == cpu)
+				return node;
+		}
+	}
+	return 0;
+}
+
+/* Binds the pages of [address, address + bytes) to 'node'. 'address' must
+   be page-aligned. Returns false if the kernel refused; the memory is still
+   usable, just not bound. */
+inline bool bindToNumaNode(void* address, std::size_t bytes, int node)
+{
+	/* Note: From <linux/mempolicy.h>, which we don't want to depend on. */
+	constexpr int mpol_bind = 2;
+	constexpr unsigned mpol_mf_move = 1u << 1;
+
+	constexpr int mask_words = 16;  /* Up to 1024 nodes */
+	constexpr int mask_bits = mask_words * sizeof(unsigned long) * CHAR_BIT;
+	if (node < 0 || node >= mask_bits)
+		return false;
+
+	unsigned long mask[mask_words]{};
+	mask[node / (sizeof(unsigned long) * CHAR_BIT)] =
+		1ul << (node % (sizeof(unsigned long) * CHAR_BIT));
+
+	/* Note: The kernel ignores the last of the 'maxnode' bits, hence + 1.
+	   See: 'BUGS' in mbind(2). */
+	return ::syscall(SYS_mbind, address, bytes, mpol_bind, mask,
+		static_cast<unsigned long>(mask_bits) + 1, mpol_mf_move) == 0;
+}
+
+/* Maps 'bytes' of memory and binds it to 'node' (if it's not negative). */
+inline void* allocateOnNumaNode(std::size_t bytes, int node)
+{
+	void* p = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (p == MAP_FAILED)
+		throw std::bad_alloc{};
+	if (node >= 0)
+		bindToNumaNode(p, bytes, node);
+	return p;
+}
+
+inline void deallocateOnNumaNode(void* p, std::size_t bytes) noexcept
+{
+	::munmap(p, bytes);
+}
+
+/* An allocator whose memory is bound to one NUMA node. A negative node means
+   no binding at all. */
+template<typename T>
+class NumaAllocator
+{
+public:
+	using value_type = T;
+
+	explicit NumaAllocator(int node = -1) noexcept : node_{node} {}
+
+	template<typename U>
+	NumaAllocator(NumaAllocator<U> const& other) noexcept
+		: node_{other.getNode()}
+	{}
+
+	/* An allocator for the node 'cpu' is on, e.g. the Consumer's. */
+	static NumaAllocator forCpu(int cpu)
+	{
+		return NumaAllocator{cpu < 0 ? -1 : getNumaNodeOfCpu(cpu)};
+	}
+
+	int getNode() const noexcept { return node_; }
+
+	T* allocate(std::size_t n)
+	{
+		return static_cast<T*>(allocateOnNumaNode(n * sizeof(T), node_));
+	}
+
+	void deallocate(T* p, std::size_t n) noexcept
+	{
+		deallocateOnNumaNode(p, n * sizeof(T));
+	}
+
+	template<typename U>
+	bool operator==(NumaAllocator<U> const& other) const noexcept
+	{
+		return node_ == other.getNode();
+	}
+
+private:
+	int node_;
+};
+
+struct NumaDelete
+{
+	template<typename Q>
+	void operator()(Q* q) const noexcept
+	{
+		q->~Q();
+		deallocateOnNumaNode(q, sizeof(Q));
+	}
+};
+
+template<typename Q>
+using NumaPtr = std::unique_ptr<Q, NumaDelete>;
+
+/* Constructs a Q - e.g. a queue, and with it its control lines - in memory
+   bound to 'node'. */
+template<typename Q, typename... TArgs>
+NumaPtr<Q> makeOnNumaNode(int node, TArgs&&... args)
+{
+	static_assert(alignof(Q) <= 4096);
+	void* p = allocateOnNumaNode(sizeof(Q), node);
+	try
+	{
+		return NumaPtr<Q>{new (p) Q(std::forward<TArgs>(args)...)};
+	}
+	catch (...)
+	{
+		deallocateOnNumaNode(p, sizeof(Q));
+		throw;
+	}
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <pthread.h>
+#include <sched.h>
+
+/*
+	Thread-to-CPU pinning.
+
+
+	It can pin any thread, not just the calling one, and it reports failure
+	to the caller rather than exiting the process - asking for a CPU the
+	machine doesn't have is not a reason for a library to bring down its
+	host. The benchmarks' `pinThread(cpu)` in bench.hpp is a thin wrapper
+	which does exit, since a benchmark on the wrong core is meaningless.
+*/
+
+/* Pins 'thread' to a single CPU. A negative 'cpu' leaves the thread's
+   affinity untouched. Returns false if the affinity couldn't be set.
+   Note: pthread_setaffinity_np() returns an error number rather than -1 and
+   errno, so we check against 0. */
+inline bool pinThread(int cpu, ::pthread_t thread)
+{
+	if (cpu < 0)
+		return true;
+	if (cpu >= CPU_SETSIZE)
+		return false;
+
+	::cpu_set_t cpuset;
+	CPU_ZERO(&cpuset);
+	CPU_SET(cpu, &cpuset);
+	return ::pthread_setaffinity_np(thread, sizeof(::cpu_set_t), &cpuset) == 0;
+}
@@ -0,0 +1,319 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "pin_thread.hpp"
+#include "spsc_fifo_2.hpp"
+
+/*
+	A typed, multi-stage pipeline of threads linked by SpscFifo2 queues.
+
+
+	Instead of hand-wiring threads and queues, describe the chain of work:
+
+		auto p = pipeline(config, source, stage1, stage2, sink);
+		p.run();
+
+	Every callable gets its own thread, and consecutive threads are joined by
+	an SpscFifo2 'link', so every hop stays on the lock-free SPSC path:
+
+		- The source is called with no arguments and returns a
+		  `std::optional<T0>`. Returning `std::nullopt` ends the stream.
+		- Each stage is called with a `T(i-1)` and returns a `T(i)`. The link
+		  types are deduced from the stages' return types.
+		- The sink is called with the last type. Its return value is ignored.
+
+	Every thread after the source drains its input link with
+	`SpscFifo2::popBatch()` and forwards its results with
+	`SpscFifo2::pushBatch()`, so under load each hop moves up to `batchSize`
+	items per synchronization rather than one. Batches are never held back
+	waiting to fill up though - a thread takes whatever is there - so a lone
+	item isn't delayed by batching.
+
+	End-of-stream is propagated with a `done` flag per link. Once a thread has
+	made its final push it sets the flag with Release ordering. A downstream
+	thread which Acquires the flag *before* finding its input empty knows the
+	input is drained for good, and passes the flag on.
+
+	Each thread pins itself to the CPU given in the config and keeps its own
+	statistics, which are readable once run() returns.
+*/
+
+struct PipelineConfig
+{
+	std::size_t      queueCapacity = 4096;  /* Capacity of every link */
+	std::size_t      batchSize = 64;        /* Max items moved per pop/push */
+
+	/* CPU for each thread, in order: source, stages..., sink. Threads with
+	   no entry, or an entry of -1, are left unpinned. */
+	std::vector<int> cpus;
+};
+
+/* Note: Aligned to a cache line, as each thread updates its own entry while
+   the pipeline is running. */
+struct alignas(64) PipelineStageStats
+{
+	std::uint64_t items{};     /* Items this thread has handled */
+	std::uint64_t batches{};   /* Non-empty pops from the input link */
+	std::uint64_t depthSum{};  /* Input link depth, summed over batches */
+	std::uint64_t maxDepth{};  /* Deepest the input link was seen */
+	std::chrono::steady_clock::duration elapsed{};
+	bool          pinned{};    /* False if the requested CPU couldn't be set */
+
+	double getThroughput() const noexcept
+	{
+		const double seconds =
+			std::chrono::duration<double>(elapsed).count();
+		return seconds > 0.0 ? items / seconds : 0.0;
+	}
+
+	double getMeanDepth() const noexcept
+	{
+		return batches ? static_cast<double>(depthSum) / batches : 0.0;
+	}
+};
+
+/* The queue between two threads, and its end-of-stream flag. */
+template<typename T>
+struct PipelineLink
+{
+	explicit PipelineLink(std::size_t capacity) : fifo{capacity} {}
+
+	SpscFifo2<T> fifo;
+
+	/* Set by the upstream thread after its final push. */
+	alignas(64) std::atomic<bool> done{};
+};
+
+/* Deduces the item type carried by each link: `std::tuple<T0, T1, ...>`. */
+template<typename TIn, typename... TFns>
+struct PipelineLinkTypes;
+
+template<typename TIn, typename TSink>
+struct PipelineLinkTypes<TIn, TSink>
+{
+	using type = std::tuple<TIn>;
+};
+
+template<typename TIn, typename TStage, typename TNext, typename... TRest>
+struct PipelineLinkTypes<TIn, TStage, TNext, TRest...>
+{
+	using type = decltype(std::tuple_cat(
+		std::declval<std::tuple<TIn>>(),
+		std::declval<typename PipelineLinkTypes<
+			std::decay_t<std::invoke_result_t<TStage&, TIn>>,
+			TNext, TRest...>::type>()));
+};
+
+template<typename TTypes>
+struct PipelineLinks;
+
+template<typename... Ts>
+struct PipelineLinks<std::tuple<Ts...>>
+{
+	using type = std::tuple<std::unique_ptr<PipelineLink<Ts>>...>;
+};
+
+/* Note: TFns is the stages followed by the sink. */
+template<typename TSource, typename... TFns>
+class Pipeline
+{
+	static_assert(sizeof...(TFns) >= 1, "A pipeline needs at least a sink");
+
+public:
+	using source_type =
+		typename std::decay_t<std::invoke_result_t<TSource&>>::value_type;
+	using link_types = typename PipelineLinkTypes<source_type, TFns...>::type;
+
+	static constexpr std::size_t thread_count = sizeof...(TFns) + 1;
+	static constexpr std::size_t link_count = sizeof...(TFns);
+
+	Pipeline(PipelineConfig config, TSource source, TFns... fns)
+		: config_{std::move(config)}
+		, fns_{std::move(source), std::move(fns)...}
+	{
+		if (config_.batchSize == 0)
+			config_.batchSize = 1;
+
+		[this]<std::size_t... I>(std::index_sequence<I...>) {
+			((std::get<I>(links_) = std::make_unique<
+				typename std::tuple_element_t<I, links_type>::element_type>(
+					config_.queueCapacity)), ...);
+		}(std::make_index_sequence<link_count>{});
+	}
+
+	/* Runs every thread to completion, i.e. until the source has ended the
+	   stream and the sink has consumed everything. Call at most once. */
+	void run()
+	{
+		{
+			std::vector<std::jthread> threads;
+			threads.reserve(thread_count);
+
+			threads.emplace_back([this] { runSource(); });
+			[&]<std::size_t... I>(std::index_sequence<I...>) {
+				(threads.emplace_back([this] { runStage<I + 1>(); }), ...);
+			}(std::make_index_sequence<thread_count - 2>{});
+			threads.emplace_back([this] { runSink(); });
+
+			/* Note: std::jthread (C++20) joins on destruction. */
+		}
+	}
+
+	/* Per-thread statistics, in order: source, stages..., sink. Only
+	   meaningful once run() has returned. */
+	std::array<PipelineStageStats, thread_count> const& getStats() const noexcept
+	{
+		return stats_;
+	}
+
+private:
+	using links_type = typename PipelineLinks<link_types>::type;
+	using clock = std::chrono::steady_clock;
+
+	template<std::size_t I>
+	using link_value_type = std::tuple_element_t<I, link_types>;
+
+	PipelineStageStats& beginThread(std::size_t index)
+	{
+		PipelineStageStats& stats = stats_[index];
+		const int cpu = index < config_.cpus.size() ? config_.cpus[index] : -1;
+		stats.pinned = pinThread(cpu, ::pthread_self());
+		return stats;
+	}
+
+	template<typename T>
+	static void pushAll(SpscFifo2<T>& fifo, T const* values, std::size_t count)
+	{
+		while (count != 0)
+		{
+			const std::size_t n = fifo.pushBatch(values, count);
+			values += n;
+			count -= n;
+		}
+	}
+
+	/* Pops the next batch from 'in' into 'buffer'. Returns 0 only once the
+	   input is done and drained. */
+	template<typename T>
+	std::size_t popNext(PipelineLink<T>& in, std::vector<T>& buffer,
+		PipelineStageStats& stats)
+	{
+		for (;;)
+		{
+			/* Note: Acquire the flag *before* popping. If the flag was set
+			   and the pop still finds nothing, every push has been seen. */
+			const bool done = in.done.load(std::memory_order_acquire);
+			const std::size_t n =
+				in.fifo.popBatch(buffer.data(), buffer.size());
+			if (n != 0)
+			{
+				const std::uint64_t depth = n + in.fifo.getSize();
+				stats.items += n;
+				++stats.batches;
+				stats.depthSum += depth;
+				stats.maxDepth = std::max(stats.maxDepth, depth);
+				return n;
+			}
+			if (done)
+				return 0;
+		}
+	}
+
+	void runSource()
+	{
+		PipelineStageStats& stats = beginThread(0);
+		const auto start = clock::now();
+
+		auto& source = std::get<0>(fns_);
+		auto& out = *std::get<0>(links_);
+		while (auto item = source())
+		{
+			while (!out.fifo.push(*item))
+				;
+			++stats.items;
+		}
+		out.done.store(true, std::memory_order_release);
+
+		stats.elapsed = clock::now() - start;
+	}
+
+	template<std::size_t I>
+	void runStage()
+	{
+		using in_type = link_value_type<I - 1>;
+		using out_type = link_value_type<I>;
+
+		PipelineStageStats& stats = beginThread(I);
+		const auto start = clock::now();
+
+		auto& stage = std::get<I>(fns_);
+		auto& in = *std::get<I - 1>(links_);
+		auto& out = *std::get<I>(links_);
+
+		std::vector<in_type> inBuffer(config_.batchSize);
+		std::vector<out_type> outBuffer;
+		outBuffer.reserve(config_.batchSize);
+
+		while (const std::size_t n = popNext(in, inBuffer, stats))
+		{
+			for (std::size_t i = 0; i < n; ++i)
+				outBuffer.push_back(std::invoke(stage, std::move(inBuffer[i])));
+			pushAll(out.fifo, outBuffer.data(), outBuffer.size());
+			outBuffer.clear();
+		}
+		out.done.store(true, std::memory_order_release);
+
+		stats.elapsed = clock::now() - start;
+	}
+
+	void runSink()
+	{
+		using in_type = link_value_type<link_count - 1>;
+
+		PipelineStageStats& stats = beginThread(thread_count - 1);
+		const auto start = clock::now();
+
+		auto& sink = std::get<thread_count - 1>(fns_);
+		auto& in = *std::get<link_count - 1>(links_);
+
+		std::vector<in_type> inBuffer(config_.batchSize);
+		while (const std::size_t n = popNext(in, inBuffer, stats))
+		{
+			for (std::size_t i = 0; i < n; ++i)
+				std::invoke(sink, std::move(inBuffer[i]));
+		}
+
+		stats.elapsed = clock::now() - start;
+	}
+
+	PipelineConfig                                 config_;
+	std::tuple<TSource, TFns...>                   fns_;
+	links_type                                     links_;
+
+	/* Note: Each entry is only written by its own thread, and only read
+	   after the threads are joined. */
+	std::array<PipelineStageStats, thread_count>   stats_{};
+};
+
+/* pipeline(config, source, stages..., sink) */
+template<typename TSource, typename... TFns>
+Pipeline<TSource, TFns...> pipeline(PipelineConfig config, TSource source,
+	TFns... fns)
+{
+	return Pipeline<TSource, TFns...>{std::move(config), std::move(source),
+		std::move(fns)...};
+}
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#include "spsc_fifo_2.hpp"
+
+/*
+	A thread-safe Single-Consumer, Single-Producer FIFO of pointers whose
+	Consumer prefetches the pointed-to objects a few items ahead.
+
+
+	When a queue carries `Message*`, the slots themselves are cheap: they are
+	read in order and the hardware prefetcher keeps up with them. The cost is
+	dereferencing each pointer, a cache miss into a large pool on nearly every
+	item, taken one at a time. But the Consumer can already see the pointers
+	it will need next. So while it processes item 'i' it issues a prefetch
+	for the object of item 'i + Distance', and by the time it gets there that
+	object is (ideally) in cache.
+
+	Objects span different numbers of cache lines, so the Producer - which
+	knows what it's sending - attaches a hint to each pointer saying how many
+	lines to prefetch. The slot is then a pointer and a line count, 16 bytes.
+
+	The prefetching happens in `consumeN()`/`consumeAll()`, which walk the
+	readable region via `SpscFifo2::readableSpans(max)` and so can look ahead
+	without re-reading the Producer's position per item. Distance is a
+	template parameter: too short and the prefetch doesn't land in time, too
+	long and the lines are evicted again before use - 4 to 16 is typical.
+
+	See: https://gcc.gnu.org/onlinedocs/gcc/Other-Builtins.html (__builtin_prefetch)
+*/
+
+template<typename T, std::size_t Distance = 8>
+class PrefetchFifo
+{
+public:
+	struct Slot
+	{
+		T*            pointer;
+		std::uint32_t lines;  /* Cache lines of *pointer to prefetch */
+	};
+
+	using fifo_type = SpscFifo2<Slot>;
+	using size_type = typename fifo_type::size_type;
+	using value_type = T*;
+
+	static constexpr std::size_t cache_line_size = 64;
+
+	/* Note: 'defaultLines' is the hint for push()es which don't give one. */
+	explicit PrefetchFifo(size_type capacity, std::uint32_t defaultLines = 1)
+		: fifo_{capacity}
+		, default_lines_{defaultLines}
+	{}
+
+	PrefetchFifo(PrefetchFifo const&) = delete;
+	PrefetchFifo& operator=(PrefetchFifo const&) = delete;
+	PrefetchFifo(PrefetchFifo&&) = delete;
+	PrefetchFifo& operator=(PrefetchFifo&&) = delete;
+
+	size_type getCapacity() const noexcept { return fifo_.getCapacity(); }
+
+	size_type getSize() const noexcept { return fifo_.getSize(); }
+
+	bool isEmpty() const noexcept { return fifo_.isEmpty(); }
+
+	/* Note: Producer thread only. */
+	bool push(T* pointer) { return fifo_.push(Slot{pointer, default_lines_}); }
+
+	/* Pushes 'pointer' with a hint to prefetch 'lines' cache lines of the
+	   object, e.g. `(sizeof(*pointer) + 63) / 64`, or only the header lines
+	   the Consumer will actually read.
+	   Note: Producer thread only. */
+	bool push(T* pointer, std::uint32_t lines)
+	{
+		return fifo_.push(Slot{pointer, lines});
+	}
+
+	/* Pops one pointer, without prefetching.
+	   Note: Consumer thread only. */
+	bool pop(T*& pointer)
+	{
+		Slot slot;
+		if (!fifo_.pop(slot))
+			return false;
+		pointer = slot.pointer;
+		return true;
+	}
+
+	/* Calls 'f(T*)' on up to 'max' of the oldest pointers, prefetching the
+	   object 'Distance' items ahead of the one being processed, then pops
+	   them all with a single store. Returns how many there were. As with
+	   SpscFifo2::consumeN(), if 'f' throws, the pointers before the one it
+	   threw on are popped; that one and the rest stay in the queue.
+	   Note: Consumer thread only. */
+	template<typename F>
+	size_type consumeN(F&& f, size_type max)
+	{
+		const auto spans = fifo_.readableSpans(max);
+		const size_type n = spans.size();
+		const size_type first = static_cast<size_type>(spans.first.size());
+
+		auto at = [&](size_type i) -> Slot const& {
+			return i < first ? spans.first[i] : spans.second[i - first];
+		};
+
+		for (size_type i = 0; i < std::min<size_type>(Distance, n); ++i)
+			prefetch(at(i));
+
+		size_type i = 0;
+		try
+		{
+			for (; i < n; ++i)
+			{
+				if (i + Distance < n)
+					prefetch(at(i + Distance));
+				f(at(i).pointer);
+			}
+		}
+		catch (...)
+		{
+			fifo_.advanceRead(i);
+			throw;
+		}
+
+		fifo_.advanceRead(n);
+		return n;
+	}
+
+	/* consumeN() over everything the Producer has published so far.
+	   Note: Consumer thread only. */
+	template<typename F>
+	size_type consumeAll(F&& f)
+	{
+		return consumeN(std::forward<F>(f), fifo_type::positions_type::all);
+	}
+
+private:
+	static void prefetch(Slot const& slot) noexcept
+	{
+		auto const* bytes = reinterpret_cast<char const*>(slot.pointer);
+		for (std::uint32_t line = 0; line < slot.lines; ++line)
+			__builtin_prefetch(bytes + line * cache_line_size, 0, 3);
+	}
+
+	fifo_type     fifo_;
+	std::uint32_t default_lines_;
+};
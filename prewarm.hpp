@@ -0,0 +1,39 @@
+#pragma once
+
+#include <thread>
+
+#include "pin_thread.hpp"
+
+/*
+	First-touch a queue's buffer from a chosen CPU.
+
+
+	On Linux, anonymous memory is placed on the NUMA node of the CPU which
+	first writes to each page - not the one which allocated it. A queue is
+	usually constructed on some control thread, so unless its buffer is
+	touched from the right CPU before use it ends up wherever that control
+	thread happened to run.
+
+	prewarmOnCpu() runs the queue's `prewarm()` on a short-lived thread pinned
+	to 'cpu' (typically the Consumer's, which reads every slot), and waits for
+	it. Together with the optional mlock() that means the first lap of the
+	queue runs at steady-state speed, without faults and without having to
+	push dummy traffic through it first.
+
+		SpscFifo2<Order> q{65536};
+		prewarmOnCpu(q, consumerCpu, true);
+*/
+
+/* Returns false if the thread couldn't be pinned or the lock couldn't be
+   taken. The pages are touched either way.
+   Note: Call before the queue is in use. */
+template<typename TFifo>
+bool prewarmOnCpu(TFifo& fifo, int cpu, bool lock = false)
+{
+	bool ok = false;
+	std::thread{[&] {
+		const bool pinned = pinThread(cpu, ::pthread_self());
+		ok = fifo.prewarm(lock) && pinned;
+	}}.join();
+	return ok;
+}
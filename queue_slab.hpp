@@ -0,0 +1,200 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <vector>
+
+#include <sys/mman.h>
+
+/*
+	A slab of memory, ideally backed by huge pages, to carve many small queues
+	out of.
+
+
+	Allocating 20,000 queue headers and their small rings one by one from the
+	heap scatters them over thousands of 4 KB pages, each costing a TLB entry
+	and each carrying the allocator's own headers. A QueueSlab maps one large
+	region up front - with explicit huge pages (MAP_HUGETLB) if the system
+	has any reserved, or else as normal pages with a transparent huge page
+	hint (MADV_HUGEPAGE) - and hands out cache-line-aligned blocks from it
+	with a bump pointer. Freed blocks go onto a free list per size (in whole
+	cache lines), so a slab can be used for queues that come and go.
+
+	Pair it with SlabAllocator for the rings and `create()` for the queue
+	headers themselves:
+
+		QueueSlab slab{64 << 20};
+		auto* q = slab.create<CompactSpscFifo<int, SlabAllocator<int>>>(
+			16, SlabAllocator<int>{slab});
+		...
+		slab.destroy(q);
+
+	Note: A QueueSlab isn't thread-safe. Queues are expected to be created and
+	destroyed from one control thread; using them is as thread-safe as the
+	queues themselves.
+*/
+
+class QueueSlab
+{
+public:
+	static constexpr std::size_t block_alignment = 64;
+
+	/* Note: 'bytes' is rounded up to a whole number of 2 MB huge pages. */
+	explicit QueueSlab(std::size_t bytes)
+		: capacity_{(bytes + huge_page_size - 1) / huge_page_size * huge_page_size}
+	{
+		void* p = ::mmap(nullptr, capacity_, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		huge_pages_ = p != MAP_FAILED;
+		if (!huge_pages_)
+		{
+			p = ::mmap(nullptr, capacity_, PROT_READ | PROT_WRITE,
+				MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+			if (p == MAP_FAILED)
+				throw std::bad_alloc{};
+			/* Note: Only a hint; fine if transparent huge pages are off. */
+			::madvise(p, capacity_, MADV_HUGEPAGE);
+		}
+		region_ = static_cast<std::byte*>(p);
+	}
+
+	QueueSlab(QueueSlab const&) = delete;
+	QueueSlab& operator=(QueueSlab const&) = delete;
+	QueueSlab(QueueSlab&&) = delete;
+	QueueSlab& operator=(QueueSlab&&) = delete;
+
+	~QueueSlab() { ::munmap(region_, capacity_); }
+
+	std::size_t getCapacity() const noexcept { return capacity_; }
+
+	/* Bytes handed out and not yet returned. */
+	std::size_t getUsed() const noexcept { return used_; }
+
+	/* True if the slab got explicit huge pages. */
+	bool isHugePages() const noexcept { return huge_pages_; }
+
+	/* Returns a block of at least 'bytes', aligned to a cache line. Throws
+	   std::bad_alloc once the slab is exhausted. */
+	void* allocate(std::size_t bytes)
+	{
+		const std::size_t lines = toLines(bytes);
+
+		/* Note: Make room for this size's free list here, where throwing is
+		   fine, so that deallocate() never has to grow free_. */
+		if (lines >= free_.size())
+			free_.resize(lines + 1);
+
+		used_ += lines * block_alignment;
+
+		if (free_[lines] != nullptr)
+		{
+			FreeBlock* block = free_[lines];
+			free_[lines] = block->next;
+			return block;
+		}
+
+		const std::size_t size = lines * block_alignment;
+		if (capacity_ - top_ < size)
+		{
+			used_ -= size;
+			throw std::bad_alloc{};
+		}
+		void* p = region_ + top_;
+		top_ += size;
+		return p;
+	}
+
+	/* Returns a block to the slab. 'bytes' must match the allocate() call. */
+	void deallocate(void* p, std::size_t bytes) noexcept
+	{
+		const std::size_t lines = toLines(bytes);
+		assert(lines < free_.size());
+		used_ -= lines * block_alignment;
+
+		free_[lines] = new (p) FreeBlock{free_[lines]};
+	}
+
+	/* Constructs a Q (e.g. a queue header) in the slab. */
+	template<typename Q, typename... TArgs>
+	Q* create(TArgs&&... args)
+	{
+		static_assert(alignof(Q) <= block_alignment);
+		void* p = allocate(sizeof(Q));
+		try
+		{
+			return new (p) Q(std::forward<TArgs>(args)...);
+		}
+		catch (...)
+		{
+			deallocate(p, sizeof(Q));
+			throw;
+		}
+	}
+
+	template<typename Q>
+	void destroy(Q* q) noexcept
+	{
+		q->~Q();
+		deallocate(q, sizeof(Q));
+	}
+
+private:
+	static constexpr std::size_t huge_page_size = std::size_t{2} << 20;
+
+	struct FreeBlock
+	{
+		FreeBlock* next;
+	};
+
+	static std::size_t toLines(std::size_t bytes) noexcept
+	{
+		return bytes == 0 ? 1 : (bytes + block_alignment - 1) / block_alignment;
+	}
+
+	std::byte*              region_;
+	std::size_t             capacity_;
+	std::size_t             top_{};    /* Bump pointer */
+	std::size_t             used_{};
+	bool                    huge_pages_{};
+	std::vector<FreeBlock*> free_;     /* free_[n]: blocks of n lines */
+};
+
+/* An allocator that allocates from a QueueSlab. */
+template<typename T>
+class SlabAllocator
+{
+	static_assert(alignof(T) <= QueueSlab::block_alignment);
+
+public:
+	using value_type = T;
+
+	explicit SlabAllocator(QueueSlab& slab) noexcept : slab_{&slab} {}
+
+	template<typename U>
+	SlabAllocator(SlabAllocator<U> const& other) noexcept
+		: slab_{&other.getSlab()}
+	{}
+
+	QueueSlab& getSlab() const noexcept { return *slab_; }
+
+	T* allocate(std::size_t n)
+	{
+		return static_cast<T*>(slab_->allocate(n * sizeof(T)));
+	}
+
+	void deallocate(T* p, std::size_t n) noexcept
+	{
+		slab_->deallocate(p, n * sizeof(T));
+	}
+
+	template<typename U>
+	bool operator==(SlabAllocator<U> const& other) const noexcept
+	{
+		return slab_ == &other.getSlab();
+	}
+
+private:
+	QueueSlab* slab_;
+};
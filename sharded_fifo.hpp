@@ -0,0 +1,128 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "spsc_fifo_2.hpp"
+
+/*
+	An ordered stream sharded across K SPSC lanes, with reassembly.
+
+
+	A single SpscFifo2 pair tops out at whatever throughput one Consumer thread
+	can manage. When a single stream needs more than one Consumer core but must
+	still come out the other end in order, we can shard it: the Producer stamps
+	every item with a sequence number and hands items out round-robin over K
+	input lanes, each drained by its own Worker thread. Every Worker pushes its
+	results into its own output lane, and a single Reassembler (the final
+	Consumer) stitches the K output lanes back together in sequence order.
+
+		Producer --> in[0] --> Worker 0 --> out[0] --+
+		         --> in[1] --> Worker 1 --> out[1] --+--> Reassembler
+		         --> ...                    ...      |
+		         --> in[K-1] -> Worker K-1 -> out[K-1]
+
+	Every lane is a plain SpscFifo2, so every hop stays on the lock-free SPSC
+	path: lane 'k' has exactly one Producer and one Consumer.
+
+	The reorder window is the set of K output lane heads. Because sequence
+	number 's' is always routed through lane 's % K', and each lane is FIFO, the
+	next item in global order is always at the head of lane 'next % K'. The
+	Reassembler never has to buffer or sort anything - it just waits on the
+	right lane. The price is that a slow Worker stalls the whole stream (head of
+	line blocking), which is inherent to any ordered sharding scheme.
+
+	Workers must emit exactly one output item per input item, carrying the
+	input's sequence number through untouched.
+*/
+
+/* An item tagged with its position in the original stream. */
+template<typename T>
+struct Sequenced
+{
+	std::uint64_t seq{};
+	T             value{};
+};
+
+template<typename TIn, typename TOut = TIn>
+class ShardedFifo
+{
+public:
+	using in_lane_type = SpscFifo2<Sequenced<TIn>>;
+	using out_lane_type = SpscFifo2<Sequenced<TOut>>;
+	using size_type = typename in_lane_type::size_type;
+
+	/* Note: 'laneCapacity' is per lane, so the total number of items in
+	   flight is bounded by 2 * lanes * laneCapacity. */
+	ShardedFifo(size_type lanes, size_type laneCapacity)
+	{
+		assert(lanes > 0);
+		/* Note: SpscFifo2 can't be moved, so each lane lives on the heap
+		   behind a unique_ptr. The lanes are never resized after this. */
+		in_.reserve(lanes);
+		out_.reserve(lanes);
+		for (size_type k = 0; k < lanes; ++k)
+		{
+			in_.push_back(std::make_unique<in_lane_type>(laneCapacity));
+			out_.push_back(std::make_unique<out_lane_type>(laneCapacity));
+		}
+	}
+
+	ShardedFifo(ShardedFifo const&) = delete;
+	ShardedFifo& operator=(ShardedFifo const&) = delete;
+	ShardedFifo(ShardedFifo&&) = delete;
+	ShardedFifo& operator=(ShardedFifo&&) = delete;
+
+	size_type getLaneCount() const noexcept { return in_.size(); }
+
+	/* Producer thread only. Returns false if the target lane is full; the
+	   caller must retry with the same value to keep ordering intact. */
+	bool push(TIn const& value)
+	{
+		const std::uint64_t seq = push_seq_;
+		if (!in_[seq % in_.size()]->push(Sequenced<TIn>{seq, value}))
+			return false;
+		++push_seq_;
+		return true;
+	}
+
+	/* Worker 'lane' thread only. */
+	bool workerPop(size_type lane, Sequenced<TIn>& item)
+	{
+		return in_[lane]->pop(item);
+	}
+
+	/* Worker 'lane' thread only. 'item.seq' must be the sequence number of
+	   the input it was produced from. */
+	bool workerPush(size_type lane, Sequenced<TOut> const& item)
+	{
+		assert(item.seq % out_.size() == lane);
+		return out_[lane]->push(item);
+	}
+
+	/* Reassembler (Consumer) thread only. Returns items in the exact order
+	   they were given to push(). */
+	bool pop(TOut& value)
+	{
+		const std::uint64_t seq = pop_seq_;
+		Sequenced<TOut> item;
+		if (!out_[seq % out_.size()]->pop(item))
+			return false;
+		assert(item.seq == seq);
+		value = item.value;
+		++pop_seq_;
+		return true;
+	}
+
+private:
+	std::vector<std::unique_ptr<in_lane_type>>  in_;
+	std::vector<std::unique_ptr<out_lane_type>> out_;
+
+	/* Note: The two sequence counters are each owned by a different thread
+	   (Producer and Reassembler), so keep them on separate cache lines. */
+	alignas(64) std::uint64_t push_seq_{};  /* Exclusive to Producer thread. */
+	alignas(64) std::uint64_t pop_seq_{};   /* Exclusive to Reassembler thread. */
+	char padding_[64 - sizeof(std::uint64_t)];
+};
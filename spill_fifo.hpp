@@ -0,0 +1,132 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <type_traits>
+
+#include "mmap_file_allocator.hpp"
+#include "spsc_fifo_2.hpp"
+
+/*
+	A thread-safe Single-Consumer, Single-Producer FIFO which spills to disk
+	when its in-memory ring is full.
+
+
+	During a rare upstream stall, an SpscFifo2 fills up and the Producer has
+	to either spin (stalling whatever feeds it) or drop data. SpillFifo
+	instead keeps two SpscFifo2s: the usual in-memory 'ring', and a much larger
+	'spill' queue whose buffer is an mmap()'d file (see MmapFileAllocator).
+
+	Ordering is preserved with one rule on each side:
+
+		- Producer: once a push() has gone to the spill, every push() goes to
+		  the spill until the Consumer has drained it. Only then does the
+		  Producer go back to the ring. So everything in the ring is older
+		  than everything in the spill.
+
+		- Consumer: pop from the ring first. Only when the ring is empty look
+		  at the spill - and if the spill does have something, check the ring
+		  once more before taking it. Seeing the spill's push_pos_ (with
+		  Acquire) means seeing every ring push() made before it, so the
+		  second check can't miss an older item still in the ring.
+
+	While the Consumer keeps up, the spill is never touched and the cost over
+	a plain SpscFifo2 is one predictable branch per push(). While it doesn't,
+	the spill absorbs the backlog at the cost of page faults and, eventually,
+	disk writeback. A push() only fails if the spill is full too.
+
+	Items are copied into file-backed memory, so T must be trivially copyable.
+*/
+
+template<typename T>
+class SpillFifo
+{
+	static_assert(std::is_trivially_copyable_v<T>,
+		"SpillFifo items must be trivially copyable");
+
+public:
+	using ring_type = SpscFifo2<T>;
+	using spill_type = SpscFifo2<T, MmapFileAllocator<T>>;
+	using size_type = typename ring_type::size_type;
+	using value_type = T;
+
+	/* Note: The spill file is sparse, so a large 'spillCapacity' costs disk
+	   space only while it's actually in use. */
+	SpillFifo(size_type capacity, size_type spillCapacity,
+		MmapFileAllocator<T> const& spillAlloc = MmapFileAllocator<T>{})
+		: ring_{capacity}
+		, spill_{spillCapacity, spillAlloc}
+	{}
+
+	SpillFifo(SpillFifo const&) = delete;
+	SpillFifo& operator=(SpillFifo const&) = delete;
+	SpillFifo(SpillFifo&&) = delete;
+	SpillFifo& operator=(SpillFifo&&) = delete;
+
+	size_type getCapacity() const noexcept { return ring_.getCapacity(); }
+
+	size_type getSpillCapacity() const noexcept { return spill_.getCapacity(); }
+
+	size_type getSize() const noexcept
+	{
+		return ring_.getSize() + spill_.getSize();
+	}
+
+	bool isEmpty() const noexcept { return getSize() == 0; }
+
+	/* Number of items which have gone to the spill so far.
+	   Note: Producer thread only. */
+	std::uint64_t getSpillCount() const noexcept { return spill_count_; }
+
+	/* Returns false only if both the ring and the spill are full.
+	   Note: Producer thread only. */
+	bool push(T const& value)
+	{
+		if (spilling_)
+		{
+			/* Note: The spill is only empty once the Consumer has popped
+			   everything in it, so from here on the ring is in order again. */
+			if (!spill_.isEmpty())
+				return pushSpill(value);
+			spilling_ = false;
+		}
+
+		if (ring_.push(value))
+			return true;
+
+		spilling_ = true;
+		return pushSpill(value);
+	}
+
+	/* Note: Consumer thread only. */
+	bool pop(T& value)
+	{
+		if (ring_.pop(value))
+			return true;
+
+		/* Note: front() Acquires the spill's push_pos_, after which the ring
+		   pop() below is guaranteed to see anything pushed to the ring before
+		   the spill was used. */
+		if (spill_.front() == nullptr)
+			return false;
+		if (ring_.pop(value))
+			return true;
+		return spill_.pop(value);
+	}
+
+private:
+	bool pushSpill(T const& value)
+	{
+		if (!spill_.push(value))
+			return false;
+		++spill_count_;
+		return true;
+	}
+
+	ring_type  ring_;
+	spill_type spill_;
+
+	/* Exclusive to Producer thread. */
+	bool          spilling_{};
+	std::uint64_t spill_count_{};
+};
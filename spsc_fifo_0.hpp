@@ -4,6 +4,8 @@
 #include <cassert>
 #include <memory>
 
+#include "cache_aligned_allocator.hpp"
+
 /* 
 	A thread-safe Single-Consumer, Single-Producer circular FIFO queue.
 
@@ -18,8 +20,10 @@
 	See: https://en.cppreference.com/w/cpp/atomic/atomic
 */
 
-/* Note: Optional allocator type for user-specified allocation policies. */
-template<typename T, typename TAlloc = std::allocator<T>>
+/* Note: Optional allocator type for user-specified allocation policies.
+   The default aligns the buffer to whole cache lines, so its first and last
+   slots don't share a line with unrelated heap data. */
+template<typename T, typename TAlloc = CacheAlignedAllocator<T>>
 class SpscFifo0 : private TAlloc
 {
 public:
@@ -4,6 +4,8 @@
 #include <cassert>
 #include <memory>
 
+#include "cache_aligned_allocator.hpp"
+
 /* 
 	A thread-safe Single-Consumer, Single-Producer circular FIFO queue with
 	optimized inter-thread synchronization, and false-sharing-avoidance.
@@ -56,8 +58,10 @@
 	See also: https://en.cppreference.com/w/cpp/language/alignas
 */
 
-/* Note: Optional allocator type for user-specified allocation policies. */
-template<typename T, typename TAlloc = std::allocator<T>>
+/* Note: Optional allocator type for user-specified allocation policies.
+   The default aligns the buffer to whole cache lines, so its first and last
+   slots don't share a line with unrelated heap data. */
+template<typename T, typename TAlloc = CacheAlignedAllocator<T>>
 class SpscFifo1 : private TAlloc
 {
 public:
@@ -1,8 +1,20 @@
 #pragma once
 
-#include <atomic>
+#include <algorithm>
 #include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
 #include <memory>
+#include <span>
+#include <type_traits>
+#include <utility>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "cache_aligned_allocator.hpp"
+#include "spsc_positions.hpp"
 
 /* 
 	A thread-safe Single-Consumer, Single-Producer circular FIFO queue with
@@ -28,18 +40,30 @@
 	As before, we also must make sure that these two new variables exists on
 	their own cache line, and so they are aligned in the same way as the
 	original shared variables.
+
+	The positions, their cached copies and the handshake between them live in
+	SpscPositions (see spsc_positions.hpp), so that the queues built the same
+	way as this one can share them.
 */
 
-/* Note: Optional allocator type for user-specified allocation policies. */
-template<typename T, typename TAlloc = std::allocator<T>>
+/* Note: Optional allocator type for user-specified allocation policies.
+   The default aligns the buffer to whole cache lines, so its first and last
+   slots don't share a line with unrelated heap data.
+   Note: Optional separation, in bytes, between the position variables, and
+   optional type for the positions and capacity - see SpscPositions. */
+template<typename T, typename TAlloc = CacheAlignedAllocator<T>,
+	std::size_t InterferenceSize = 64,
+	typename TIndex = typename std::allocator_traits<TAlloc>::size_type>
 class SpscFifo2 : private TAlloc
 {
 public:
 	/* Note: std::allocator_traits is C++11
 	   See: https://en.cppreference.com/w/cpp/memory/allocator_traits */
 	using allocator_traits = std::allocator_traits<TAlloc>;
+	using positions_type = SpscPositions<TIndex, InterferenceSize>;
 
-	using size_type = typename allocator_traits::size_type;
+	/* Note: Positions wrap around - see SpscPositions::size_type. */
+	using size_type = typename positions_type::size_type;
 	using value_type = T;
 
 	/* Note: We mark the constructor as explicit to avoid unexpected implicit
@@ -48,6 +72,7 @@ public:
 		: TAlloc{alloc}
 		, capacity_{capacity}
 		, allocation_{allocator_traits::allocate(*this, capacity_)}
+		, positions_{capacity}
 	{}
 
 	/* Note: Explicity delete the copy and move constructors/operator
@@ -59,42 +84,28 @@ public:
 
 	~SpscFifo2()
 	{
-		while (!isEmpty())
-		{
-			allocation_[pop_pos_ % capacity_].~T();
-			++pop_pos_;
-		}
+		const size_type push_pos = positions_.getPushPos();
+		for (size_type pos = positions_.getPopPos(); pos != push_pos; ++pos)
+			allocation_[pos % capacity_].~T();
+		if (locked_)
+			::munlock(allocation_, capacity_ * sizeof(T));
 		allocator_traits::deallocate(*this, allocation_, capacity_);
 	}
 
 	size_type getCapacity() const noexcept { return capacity_; }
 
-	size_type getSize() const noexcept
-	{
-		/* Note: We prevent the default usage of the Sequentailly-consistent
-		   operation ordering policy by specifying these load() operations to
-		   use the Relaxed ordering policy, avoiding the unnecessary
-		   and costly thread synchronization constraints. */
-		const size_type push_pos = push_pos_.load(std::memory_order_relaxed);
-		const size_type pop_pos = pop_pos_.load(std::memory_order_relaxed);
-		return push_pos - pop_pos;
-	}
+	size_type getSize() const noexcept { return positions_.getSize(); }
 
-	bool isEmpty() const noexcept { return getSize() == 0; }
+	bool isEmpty() const noexcept { return positions_.isEmpty(); }
 
-	bool isFull() const noexcept { return getSize() == capacity_; }
+	bool isFull() const noexcept { return positions_.isFull(); }
 
 	bool push(T const& value)
 	{
-		/* Note: Use Relaxed operation ordering policy. */
-		const size_type push_pos = push_pos_.load(std::memory_order_relaxed);
-		if ((push_pos - pop_pos_cached_) == capacity_)
-		{
-			/* Note: Reading variable written to by other thread: Acquire! */
-			pop_pos_cached_ = pop_pos_.load(std::memory_order_acquire);
-			if ((push_pos - pop_pos_cached_) == capacity_)
-				return false;
-		}
+		/* Note: Only Acquires pop_pos_ if the cached copy says we're full. */
+		const size_type push_pos = positions_.getPushPos();
+		if (positions_.getWritable(push_pos) == 0)
+			return false;
 			
 		/* Note: Using 'Placement new' (C++17) to construct the object at the
 		   previously-allocated block of memory. This does mean we must manually
@@ -102,77 +113,428 @@ public:
 		   See: https://en.cppreference.com/w/cpp/language/new#Placement_new */
 		new (&allocation_[push_pos % capacity_]) T(value);
 
-		/* Note: Writing variable read by other thread: Release! */
-		push_pos_.store(push_pos + 1, std::memory_order_release);
+		positions_.publishPush(push_pos + 1);
 		
 		return true;
 	}
 
 	bool pop(T& value)
 	{
-		/* Note: Use Relaxed operation ordering policy. */
-		const size_type pop_pos = pop_pos_.load(std::memory_order_relaxed);
-		if (push_pos_cached_ == pop_pos)
-		{
-			/* Note: Reading variable written to by other thread: Acquire! */
-			push_pos_cached_ = push_pos_.load(std::memory_order_acquire);
-			if (push_pos_cached_ == pop_pos)
-				return false;
-		}
+		/* Note: Only Acquires push_pos_ if the cached copy says we're empty. */
+		const size_type pop_pos = positions_.getPopPos();
+		if (positions_.getReadable(pop_pos) == 0)
+			return false;
 
 		T& t = allocation_[pop_pos % capacity_];
 		value = t;
 		t.~T();
 
-		/* Note: Writing variable read by other thread: Release! */
-		pop_pos_.store(pop_pos + 1, std::memory_order_release);
+		positions_.publishPop(pop_pos + 1);
 
 		return true;
 	}
 
+	/* A group of items pushed all-or-nothing - see begin(). */
+	class Transaction
+	{
+	public:
+		Transaction() noexcept = default;
+
+		Transaction(Transaction&& other) noexcept
+			: fifo_{std::exchange(other.fifo_, nullptr)}
+			, pos_{other.pos_}
+			, reserved_{other.reserved_}
+			, size_{other.size_}
+		{}
+
+		Transaction& operator=(Transaction&& other) noexcept
+		{
+			if (this != &other)
+			{
+				abort();
+				fifo_ = std::exchange(other.fifo_, nullptr);
+				pos_ = other.pos_;
+				reserved_ = other.reserved_;
+				size_ = other.size_;
+			}
+			return *this;
+		}
+
+		Transaction(Transaction const&) = delete;
+		Transaction& operator=(Transaction const&) = delete;
+
+		/* Note: An open transaction which is neither committed nor aborted is
+		   aborted. */
+		~Transaction() { abort(); }
+
+		/* False if begin() couldn't reserve the room, or once the
+		   transaction has been committed or aborted. */
+		explicit operator bool() const noexcept { return fifo_ != nullptr; }
+
+		size_type getReserved() const noexcept { return reserved_; }
+
+		/* Number of items constructed so far. */
+		size_type getSize() const noexcept { return size_; }
+
+		/* Constructs the next item of the group. At most getReserved() items
+		   may be added. */
+		template<typename... TArgs>
+		void emplace(TArgs&&... args)
+		{
+			assert(fifo_ != nullptr && size_ < reserved_);
+			new (&fifo_->allocation_[(pos_ + size_) % fifo_->capacity_])
+				T(std::forward<TArgs>(args)...);
+			++size_;
+		}
+
+		void push(T const& value) { emplace(value); }
+
+		/* Publishes every item added so far with a single store. */
+		void commit() noexcept
+		{
+			if (fifo_ == nullptr)
+				return;
+
+			if (size_ != 0)
+				fifo_->positions_.publishPush(pos_ + size_);
+			fifo_ = nullptr;
+		}
+
+		/* Destroys every item added so far. The Consumer never saw them. */
+		void abort() noexcept
+		{
+			if (fifo_ == nullptr)
+				return;
+
+			for (size_type i = 0; i < size_; ++i)
+				fifo_->allocation_[(pos_ + i) % fifo_->capacity_].~T();
+			fifo_ = nullptr;
+		}
+
+	private:
+		friend class SpscFifo2;
+
+		Transaction(SpscFifo2& fifo, size_type pos, size_type reserved) noexcept
+			: fifo_{&fifo}
+			, pos_{pos}
+			, reserved_{reserved}
+		{}
+
+		SpscFifo2* fifo_{};
+		size_type  pos_{};
+		size_type  reserved_{};
+		size_type  size_{};
+	};
+
+	/* Reserves room for 'n' items which the Consumer will see all at once,
+	   or not at all:
+
+		if (auto tx = q.begin(1 + legs.size()))
+		{
+			tx.push(header);
+			for (auto const& leg : legs)
+				tx.push(leg);
+			tx.commit();
+		}
+
+	   Items are constructed in place by the transaction, but push_pos_ is
+	   only published by commit(), so a partial group is never visible.
+	   abort() - or an exception unwinding past the transaction - destroys
+	   whatever was constructed. Returns an empty (false) transaction if
+	   there isn't room for 'n' items.
+	   Note: Producer thread only, and only one transaction at a time; don't
+	   push() while one is open. */
+	Transaction begin(size_type n)
+	{
+		const size_type push_pos = positions_.getPushPos();
+		if (positions_.getWritable(push_pos, n, n) < n)
+			return Transaction{};
+		return Transaction{*this, push_pos, n};
+	}
+
+	/* Pushes up to 'count' items from 'values' and returns how many were
+	   pushed. The whole batch is published with a single store to push_pos_,
+	   so the Consumer sees it all at once and the shared cache line is only
+	   written once per batch rather than once per item.
+	   Note: Producer thread only. */
+	size_type pushBatch(T const* values, size_type count)
+	{
+		const size_type push_pos = positions_.getPushPos();
+		const size_type n = std::min(count, positions_.getWritable(push_pos, count));
+		for (size_type i = 0; i < n; ++i)
+			new (&allocation_[(push_pos + i) % capacity_]) T(values[i]);
+
+		if (n != 0)
+			positions_.publishPush(push_pos + n);
+
+		return n;
+	}
+
+	/* Pops up to 'max' items into 'values' and returns how many were popped.
+	   As with pushBatch(), pop_pos_ is published once for the whole batch.
+	   Note: Consumer thread only. */
+	size_type popBatch(T* values, size_type max)
+	{
+		const size_type pop_pos = positions_.getPopPos();
+		const size_type n = std::min(max, positions_.getReadable(pop_pos, max));
+		for (size_type i = 0; i < n; ++i)
+		{
+			T& t = allocation_[(pop_pos + i) % capacity_];
+			values[i] = t;
+			t.~T();
+		}
+
+		if (n != 0)
+			positions_.publishPop(pop_pos + n);
+
+		return n;
+	}
+
+	/* Calls 'f(T&)' on up to 'max' of the oldest items in place, destroying
+	   each one after 'f' returns, and returns how many there were. Nothing is
+	   copied out, and as with popBatch(), pop_pos_ is published once for the
+	   whole run. If 'f' throws, the items before the one it threw on are
+	   popped; that one and the rest stay in the queue.
+	   Note: Consumer thread only. */
+	template<typename F>
+	size_type consumeN(F&& f, size_type max)
+	{
+		const size_type pop_pos = positions_.getPopPos();
+		const size_type n = std::min(max, positions_.getReadable(pop_pos, max));
+		size_type i = 0;
+		try
+		{
+			/* Note: Step the index rather than taking 'pos % capacity_' for
+			   every item. */
+			size_type index = pop_pos % capacity_;
+			for (; i < n; ++i)
+			{
+				T& t = allocation_[index];
+				f(t);
+				t.~T();
+				if (++index == capacity_)
+					index = 0;
+			}
+		}
+		catch (...)
+		{
+			if (i != 0)
+				positions_.publishPop(pop_pos + i);
+			throw;
+		}
+
+		if (n != 0)
+			positions_.publishPop(pop_pos + n);
+
+		return n;
+	}
+
+	/* consumeN() over everything the Producer has published so far.
+	   Note: Consumer thread only. */
+	template<typename F>
+	size_type consumeAll(F&& f)
+	{
+		return consumeN(std::forward<F>(f), positions_type::all);
+	}
+
+	/* The (up to) two contiguous runs of the buffer making up a region of
+	   the ring: 'second' is only non-empty if the region wraps around the
+	   end of the buffer. */
+	struct Spans
+	{
+		std::span<T> first;
+		std::span<T> second;
+
+		size_type size() const noexcept
+		{
+			return static_cast<size_type>(first.size() + second.size());
+		}
+	};
+
+	/* Returns spans over every readable item, without popping them, so they
+	   can be handed to external (e.g. vectorized) code as plain arrays.
+	   Follow with advanceRead() to pop however many were used.
+	   Note: Consumer thread only. */
+	Spans readableSpans()
+	{
+		return readableSpans(positions_type::all);
+	}
+
+	/* readableSpans() over at most the 'max' oldest items. The Producer's
+	   position is only re-Acquired if the cached copy shows fewer.
+	   Note: Consumer thread only. */
+	Spans readableSpans(size_type max)
+	{
+		const size_type pop_pos = positions_.getPopPos();
+		return toSpans(pop_pos,
+			std::min(max, positions_.getReadable(pop_pos, max)));
+	}
+
+	/* Pops the 'n' oldest items, which must already have been seen by
+	   readableSpans(), with a single store.
+	   Note: Consumer thread only. */
+	void advanceRead(size_type n)
+	{
+		const size_type pop_pos = positions_.getPopPos();
+		assert(n <= positions_.getReadable(pop_pos, 0, 0));
+
+		if constexpr (!std::is_trivially_destructible_v<T>)
+		{
+			for (size_type i = 0; i < n; ++i)
+				allocation_[(pop_pos + i) % capacity_].~T();
+		}
+
+		if (n != 0)
+			positions_.publishPop(pop_pos + n);
+	}
+
+	/* Returns spans over every free slot, to be filled - e.g. by memcpy() -
+	   before advanceWrite() publishes them. The free slots hold no objects,
+	   so this is only for a trivially copyable T, whose objects come into
+	   being simply by writing their bytes.
+	   Note: Producer thread only. */
+	Spans writableSpans()
+	{
+		static_assert(std::is_trivially_copyable_v<T>,
+			"writableSpans() needs a trivially copyable T - use begin() instead");
+
+		const size_type push_pos = positions_.getPushPos();
+		return toSpans(push_pos, positions_.getWritable(push_pos, positions_type::all));
+	}
+
+	/* Publishes the 'n' oldest free slots, which must already have been
+	   written via writableSpans(), with a single store.
+	   Note: Producer thread only. */
+	void advanceWrite(size_type n)
+	{
+		const size_type push_pos = positions_.getPushPos();
+		assert(n <= positions_.getWritable(push_pos, 0, 0));
+
+		if (n != 0)
+			positions_.publishPush(push_pos + n);
+	}
+
+	/* Returns a pointer to the oldest item without popping it, or nullptr if
+	   the queue is empty. The item stays valid until the next pop().
+	   Note: Consumer thread only. */
+	T* front()
+	{
+		const size_type pop_pos = positions_.getPopPos();
+		if (positions_.getReadable(pop_pos) == 0)
+			return nullptr;
+		return &allocation_[pop_pos % capacity_];
+	}
+
+	/* Returns a pointer to the k-th oldest item (peek(0) is front()) without
+	   popping anything, or nullptr if there are no more than 'k' items. The
+	   Producer's position is only re-Acquired if 'k' lies beyond what was
+	   last seen of it. The item stays valid until it's popped.
+	   Note: Consumer thread only. */
+	T* peek(size_type k)
+	{
+		const size_type pop_pos = positions_.getPopPos();
+		if (positions_.getReadable(pop_pos, k + 1, k + 1) <= k)
+			return nullptr;
+		return &allocation_[(pop_pos + k) % capacity_];
+	}
+
+	/* Pops up to 'n' of the oldest items without copying them out, with a
+	   single store, and returns how many were popped.
+	   Note: Consumer thread only. */
+	size_type skip(size_type n)
+	{
+		n = std::min(n, positions_.getReadable(positions_.getPopPos(), n));
+		advanceRead(n);
+		return n;
+	}
+
+	/* Destroys, without copying out, the longest run of oldest items for
+	   which 'pred' holds, and returns how many there were. 'pred' must be
+	   partitioned over the queue - true for some prefix and false after it,
+	   as with a deadline over monotonic timestamps - which lets us find the
+	   end of the run with a binary search: O(log n) calls to 'pred' rather
+	   than one per item. The whole run is popped with a single store.
+	   Note: Consumer thread only. */
+	template<typename TPred>
+	size_type discardWhile(TPred pred)
+	{
+		const size_type pop_pos = positions_.getPopPos();
+
+		/* Note: Find the first item in [pop_pos, push_pos) for which 'pred'
+		   is false, i.e. std::partition_point over the ring. */
+		size_type first = 0;
+		size_type count = positions_.getReadable(pop_pos, positions_type::all);
+		while (count > 0)
+		{
+			const size_type step = count / 2;
+			if (pred(static_cast<T const&>(
+				allocation_[(pop_pos + first + step) % capacity_])))
+			{
+				first += step + 1;
+				count -= step + 1;
+			}
+			else
+			{
+				count = step;
+			}
+		}
+
+		if (first == 0)
+			return 0;
+
+		for (size_type i = 0; i < first; ++i)
+			allocation_[(pop_pos + i) % capacity_].~T();
+
+		positions_.publishPop(pop_pos + first);
+
+		return first;
+	}
+
+	/* Writes to every page of the buffer so that its page faults happen
+	   here, rather than one per page during the first lap of push()es, and
+	   optionally mlock()s it so it can't be paged out again. Returns false if
+	   'lock' was asked for but the lock couldn't be taken (e.g. because of
+	   RLIMIT_MEMLOCK); the pages are touched either way.
+	   On Linux a page is placed on the NUMA node of the CPU which first
+	   touches it, so call this from the thread that should own the memory -
+	   or see prewarmOnCpu().
+	   Note: Call before the queue is in use. */
+	bool prewarm(bool lock = false)
+	{
+		const std::size_t bytes = capacity_ * sizeof(T);
+		const std::size_t page_size = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+
+		/* Note: The buffer isn't necessarily page-aligned, so touch its first
+		   byte and then the start of every page after it. Nothing has been
+		   constructed in the slots yet, so any byte value will do. */
+		auto* const begin = reinterpret_cast<unsigned char volatile*>(allocation_);
+		const auto offset = reinterpret_cast<std::uintptr_t>(allocation_) % page_size;
+		if (bytes != 0)
+			begin[0] = 0;
+		for (std::size_t i = page_size - offset; i < bytes; i += page_size)
+			begin[i] = 0;
+
+		if (lock && !locked_)
+			locked_ = ::mlock(allocation_, bytes) == 0;
+		return !lock || locked_;
+	}
+
 private:
+	/* Spans over the 'count' slots from position 'pos' on. */
+	Spans toSpans(size_type pos, size_type count) const noexcept
+	{
+		const size_type index = pos % capacity_;
+		const size_type first = std::min(count, capacity_ - index);
+		return Spans{
+			std::span<T>{allocation_ + index, first},
+			std::span<T>{allocation_, count - first}};
+	}
+
 	size_type capacity_;    /* Maximum number of items */
 	T*        allocation_;  /* Handle to our allocated block of memory */
+	bool      locked_{};    /* Set by prewarm() if the buffer is mlock()ed */
 
-	using pos_type = std::atomic<size_type>;
-
-	/* Note: Here we make sure to assert that the size_type the user is using
-	   is_always_lock_free (C++17) when used with std::atomic. If it's not,
-	   then that defeats the entire purpose of this data structure!
-	   See: https://en.cppreference.com/w/cpp/atomic/atomic/is_always_lock_free */
-	static_assert(pos_type::is_always_lock_free);
-
-	/* Note: Using hardcoded alignment value instead of
-	   std::hardware_destructive_interference_size.
-	   See: g++ output:
-	   error: use of ‘std::hardware_destructive_interference_size’ [-Werror=interference-size]
-	   note: its value can vary between compiler versions or with different ‘-mtune’ or ‘-mcpu’ flags
-	   note: if this use is part of a public ABI, change it to instead use a constant variable you define
-	   note: the default value for the current CPU tuning is 64 bytes
-	   note: you can stabilize this value with ‘--param hardware_destructive_interference_size=64’, or disable this warning with ‘-Wno-interference-size’ */
-	static constexpr size_type hardware_destructive_interference_size =
-		size_type{64};
-
-	/* Points to where new items shall be constructed. 
-	   Note: Read and written-to by the Producer thread.
-	   Read by the Consumer thread.
-	   Aligned to its own cache line to avoid false-sharing. */
-	alignas(hardware_destructive_interference_size) pos_type push_pos_;
-
-	/* Points to where items should be popped from. 
-	   Note: Read and written-to by the Consumer thread.
-	   Read by the Producer thread.
-	   Aligned to its own cache line to avoid false-sharing. */
-	alignas(hardware_destructive_interference_size) pos_type pop_pos_;
-
-	/* Exclusive to Consumer thread. */
-	alignas(hardware_destructive_interference_size) size_type push_pos_cached_{};
-	
-	/* Exclusive to Producer thread. */
-	alignas(hardware_destructive_interference_size) size_type pop_pos_cached_{};
-
-	/* Node: Padding at the end of our class instance to avoid false
-	   sharing with nearby objects. Padding is equal to the HDIS minus the
-	   size of the above atomic variables' underlying type. */
-	char padding_[hardware_destructive_interference_size - sizeof(size_type)];
+	/* Note: Starts on a cache line of its own, after the (read-only)
+	   members above. */
+	positions_type positions_;
 };
\ No newline at end of file
@@ -0,0 +1,55 @@
+#pragma once
+
+/*
+	Optional USDT (user-level statically defined tracing) probes for the
+	slow paths of our FIFOs.
+
+
+	Is the Producer hitting a full queue? How often does the Consumer have to
+	go back to the other thread's position variable, and how often is there
+	nothing there? Those are exactly the branches SpscFifo2 takes when its
+	cached positions run out, so that's where the probes are:
+
+		push_refresh(fifo, push_pos, pop_pos)   pop_pos_cached_ ran out, reloaded
+		push_full(fifo, push_pos, pop_pos)      not enough room, even so
+		pop_refresh(fifo, pop_pos, push_pos)    push_pos_cached_ ran out, reloaded
+		pop_empty(fifo, pop_pos, push_pos)      not enough items, even so
+
+	They fire from every operation which can run out of its cached position
+	- push(), pop(), the batch and in-place operations, front(), peek(), the
+	spans and begin() - so e.g. a MergeFifo polling its inputs with front()
+	shows up too. A refresh counts only when the cached copy showed too
+	little for the operation to go ahead at all: the spans and
+	consumeAll() re-read the other position on every call to see everything
+	there is, and those reloads are their fast path, so they don't fire.
+	push_full fires when the operation fails for lack of room (push(),
+	begin()) or finds none at all (pushBatch(), writableSpans()), and
+	pop_empty likewise for items.
+
+	'fifo' is the address of the queue's control block - the SpscPositions
+	inside it, or for CompactSpscFifo the queue itself - not necessarily
+	the queue's own address: in SpscFifo2 the block sits one cache line in.
+	It's the same for the queue's lifetime, so one queue can still be told
+	from another.
+
+	Build with -DSPSC_FIFO_USDT and <sys/sdt.h> (systemtap-sdt-dev or
+	systemtap-sdt-devel) available, and each probe is a single nop in the
+	binary plus a note in its ELF .note.stapsdt section. A tracer such as
+	bpftrace can attach to it at run time, with no recompiling. Asking for
+	the probes without the header is an error rather than a silent no-op.
+	Without SPSC_FIFO_USDT, SPSC_FIFO_PROBE() expands to nothing and its
+	arguments aren't even evaluated. See spsc_fifo_probes.bt for a sample
+	script.
+
+	See: https://github.com/bpftrace/bpftrace/blob/master/man/adoc/bpftrace.adoc#usdt
+*/
+
+#if defined(SPSC_FIFO_USDT)
+#if !__has_include(<sys/sdt.h>)
+#error "SPSC_FIFO_USDT needs <sys/sdt.h> - install systemtap-sdt-dev(el)"
+#endif
+#include <sys/sdt.h>
+#define SPSC_FIFO_PROBE(name, ...) STAP_PROBEV(spsc_fifo, name, __VA_ARGS__)
+#else
+#define SPSC_FIFO_PROBE(name, ...) ((void)0)
+#endif
@@ -0,0 +1,230 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <limits>
+#include <type_traits>
+
+#include "spsc_fifo_probes.hpp"
+
+/*
+	The position-keeping control block of SpscFifo2, shared by the queues
+	built the same way (SpscTaskQueue, SpscSoaFifo, ElasticSpscFifo).
+
+
+	It holds the Producer's and the Consumer's positions, each on its own
+	cache line, plus each thread's cached copy of the other's, and implements
+	the handshake between them:
+
+		Producer                             Consumer
+		push_pos = getPushPos()              pop_pos = getPopPos()
+		getWritable(push_pos, ...)           getReadable(pop_pos, ...)
+		... construct the items ...          ... use the items ...
+		publishPush(push_pos + n)            publishPop(pop_pos + n)
+
+	getWritable() and getReadable() only go to the other thread's position
+	when the cached copy doesn't show enough room (or items), so that's where
+	the USDT probes of spsc_fifo_probes.hpp fire. What a 'position' counts -
+	slots, bytes, records - and where the items live is up to the queue.
+
+	Note: 'wanted' is how many slots (or items) the caller would like:
+	the other thread's position is only re-Acquired if the cached copy shows
+	fewer. Pass `all` to always re-Acquire it, and 0 to never do. 'needed'
+	is how many the caller can't do without. The probes only fire when the
+	cached copy showed fewer than that - the slow path - and not when a
+	caller merely wanted more, as the spans do on every call: push_refresh
+	(or pop_refresh) for the re-Acquire, then push_full (or pop_empty) if
+	even the re-Acquired position shows fewer.
+
+	Note: The probes' 'fifo' argument is the address of this block, which
+	sits at a fixed offset inside its queue.
+*/
+
+/* Note: Optional type for the positions and capacity - see size_type.
+   Note: Optional separation, in bytes, between the position variables - see
+   hardware_destructive_interference_size below. */
+template<typename TIndex = std::size_t, std::size_t InterferenceSize = 64>
+class SpscPositions
+{
+public:
+	/* Note: push_pos_ and pop_pos_ only ever increase, and are allowed to
+	   wrap around. Unsigned arithmetic is modulo 2^N, so 'push_pos - pop_pos'
+	   is still the size after a wrap - as long as the type isn't promoted to
+	   (signed) int first, hence at least the size of an unsigned int. The
+	   slot index 'pos % capacity' only carries on smoothly across a wrap if
+	   the capacity divides 2^N. With 64-bit positions a wrap would take
+	   centuries, but with 32 bits it takes seconds, so narrower types need a
+	   power-of-two capacity. */
+	using size_type = TIndex;
+
+	static_assert(std::is_unsigned_v<size_type> &&
+		sizeof(size_type) >= sizeof(unsigned),
+		"TIndex must be an unsigned type no narrower than unsigned int");
+
+	/* As 'wanted': as many as there are. */
+	static constexpr size_type all = std::numeric_limits<size_type>::max();
+
+	explicit SpscPositions(size_type capacity) noexcept
+		: capacity_{capacity}
+	{
+		assert(capacity > 0);
+		if constexpr (std::numeric_limits<size_type>::digits < 64)
+			assert((capacity & (capacity - 1)) == 0);
+	}
+
+	SpscPositions(SpscPositions const&) = delete;
+	SpscPositions& operator=(SpscPositions const&) = delete;
+	SpscPositions(SpscPositions&&) = delete;
+	SpscPositions& operator=(SpscPositions&&) = delete;
+
+	size_type getCapacity() const noexcept { return capacity_; }
+
+	size_type getSize() const noexcept
+	{
+		/* Note: We prevent the default usage of the Sequentailly-consistent
+		   operation ordering policy by specifying these load() operations to
+		   use the Relaxed ordering policy, avoiding the unnecessary
+		   and costly thread synchronization constraints. */
+		const size_type push_pos = push_pos_.load(std::memory_order_relaxed);
+		const size_type pop_pos = pop_pos_.load(std::memory_order_relaxed);
+		return push_pos - pop_pos;
+	}
+
+	bool isEmpty() const noexcept { return getSize() == 0; }
+
+	bool isFull() const noexcept { return getSize() == capacity_; }
+
+	/* Note: Producer thread only (or once both threads are done). */
+	size_type getPushPos() const noexcept
+	{
+		/* Note: Use Relaxed operation ordering policy. */
+		return push_pos_.load(std::memory_order_relaxed);
+	}
+
+	/* Returns how many slots are free from 'push_pos' on.
+	   Note: Producer thread only. */
+	size_type getWritable(size_type push_pos, size_type wanted = 1,
+		size_type needed = 1) noexcept
+	{
+		const size_type cached = capacity_ - (push_pos - pop_pos_cached_);
+		if (cached >= wanted)
+			return cached;
+
+		/* Note: Reading variable written to by other thread: Acquire! */
+		pop_pos_cached_ = pop_pos_.load(std::memory_order_acquire);
+		const size_type free = capacity_ - (push_pos - pop_pos_cached_);
+		if (cached < needed)
+		{
+			SPSC_FIFO_PROBE(push_refresh, this, push_pos, pop_pos_cached_);
+			if (free < needed)
+				SPSC_FIFO_PROBE(push_full, this, push_pos, pop_pos_cached_);
+		}
+		return free;
+	}
+
+	/* Makes everything constructed before 'push_pos' visible to the
+	   Consumer.
+	   Note: Producer thread only. */
+	void publishPush(size_type push_pos) noexcept
+	{
+		/* Note: Writing variable read by other thread: Release! */
+		push_pos_.store(push_pos, std::memory_order_release);
+	}
+
+	/* Note: Consumer thread only (or once both threads are done). */
+	size_type getPopPos() const noexcept
+	{
+		/* Note: Use Relaxed operation ordering policy. */
+		return pop_pos_.load(std::memory_order_relaxed);
+	}
+
+	/* Returns how many items are readable from 'pop_pos' on.
+	   Note: Consumer thread only. */
+	size_type getReadable(size_type pop_pos, size_type wanted = 1,
+		size_type needed = 1) noexcept
+	{
+		const size_type cached = push_pos_cached_ - pop_pos;
+		if (cached >= wanted)
+			return cached;
+
+		/* Note: Reading variable written to by other thread: Acquire! */
+		push_pos_cached_ = push_pos_.load(std::memory_order_acquire);
+		const size_type available = push_pos_cached_ - pop_pos;
+		if (cached < needed)
+		{
+			SPSC_FIFO_PROBE(pop_refresh, this, pop_pos, push_pos_cached_);
+			if (available < needed)
+				SPSC_FIFO_PROBE(pop_empty, this, pop_pos, push_pos_cached_);
+		}
+		return available;
+	}
+
+	/* Hands everything before 'pop_pos' back to the Producer.
+	   Note: Consumer thread only. */
+	void publishPop(size_type pop_pos) noexcept
+	{
+		/* Note: Writing variable read by other thread: Release! */
+		pop_pos_.store(pop_pos, std::memory_order_release);
+	}
+
+private:
+	using pos_type = std::atomic<size_type>;
+
+	/* Note: Here we make sure to assert that the size_type the user is using
+	   is_always_lock_free (C++17) when used with std::atomic. If it's not,
+	   then that defeats the entire purpose of this data structure!
+	   See: https://en.cppreference.com/w/cpp/atomic/atomic/is_always_lock_free */
+	static_assert(pos_type::is_always_lock_free);
+
+	/* Note: Using a template parameter instead of
+	   std::hardware_destructive_interference_size.
+	   See: g++ output:
+	   error: use of ‘std::hardware_destructive_interference_size’ [-Werror=interference-size]
+	   note: its value can vary between compiler versions or with different ‘-mtune’ or ‘-mcpu’ flags
+	   note: if this use is part of a public ABI, change it to instead use a constant variable you define
+	   note: the default value for the current CPU tuning is 64 bytes
+	   note: you can stabilize this value with ‘--param hardware_destructive_interference_size=64’, or disable this warning with ‘-Wno-interference-size’
+	   The default of 64 is one cache line. On Intel parts the L2 spatial
+	   prefetcher fetches lines in 128-byte-aligned pairs, so a write to one
+	   line can still disturb the other thread's copy of its neighbour. There,
+	   an InterferenceSize of 128 keeps every position variable in a pair of
+	   its own, at the cost of twice the memory per queue.
+	   See: Intel 64 and IA-32 Architectures Optimization Reference Manual,
+	   'Data Prefetching' */
+	/* Note: Strictly more than the last line's two variables, so that
+	   padding_ below isn't a (non-standard) zero-size array. */
+	static_assert(InterferenceSize > 2 * sizeof(size_type) &&
+		(InterferenceSize & (InterferenceSize - 1)) == 0,
+		"InterferenceSize must be a power of two greater than 2 * sizeof(TIndex)");
+	static constexpr std::size_t hardware_destructive_interference_size =
+		InterferenceSize;
+
+	/* Points to where new items shall be constructed.
+	   Note: Read and written-to by the Producer thread.
+	   Read by the Consumer thread.
+	   Aligned to its own cache line to avoid false-sharing. */
+	alignas(hardware_destructive_interference_size) pos_type push_pos_{};
+
+	/* Points to where items should be popped from.
+	   Note: Read and written-to by the Consumer thread.
+	   Read by the Producer thread.
+	   Aligned to its own cache line to avoid false-sharing. */
+	alignas(hardware_destructive_interference_size) pos_type pop_pos_{};
+
+	/* Exclusive to Consumer thread. */
+	alignas(hardware_destructive_interference_size) size_type push_pos_cached_{};
+
+	/* Exclusive to Producer thread.
+	   Note: The capacity is only needed by the Producer, to tell how much
+	   room there is, so it shares the Producer's line rather than taking one
+	   of its own. Queues keep their own copy, next to their buffer, for
+	   indexing. */
+	alignas(hardware_destructive_interference_size) size_type pop_pos_cached_{};
+	size_type capacity_;
+
+	/* Node: Padding at the end of our class instance to avoid false
+	   sharing with nearby objects. Padding is equal to the HDIS minus the
+	   size of the variables on the last line. */
+	char padding_[hardware_destructive_interference_size - 2 * sizeof(size_type)];
+};
@@ -0,0 +1,171 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <utility>
+
+#include "pin_thread.hpp"
+#include "spsc_fifo_2.hpp"
+
+/*
+	A std::execution-style (P2300 sender/receiver) scheduler whose work is run
+	by a dedicated thread draining an SpscFifo2.
+
+
+	In the sender/receiver model, 'transferring onto another thread' is just
+	another asynchronous operation:
+
+		auto op = loop.getScheduler().schedule().connect(receiver);
+		op.start();     // ... later, on the loop's thread: receiver.set_value()
+
+	`connect()` returns the operation state by value, so the caller decides
+	where it lives - typically on its own stack, or inside an enclosing
+	operation state. All `start()` has to do is push a pointer to that
+	operation state into the loop's SpscFifo2, and all the loop's thread has to
+	do is pop the pointer and complete the receiver. There's nothing to
+	allocate at any point, and no lock and no condition variable: the loop's
+	thread spins (ideally pinned to its own core) on the lock-free SPSC pop.
+
+	This is a *single producer* scheduler: all `start()`s for a given
+	SpscRunLoop must come from the same thread. Give each submitting thread
+	its own loop (or see ActorMesh for an all-pairs arrangement).
+
+	The real std::execution customization points aren't in our standard
+	library yet, so receivers here just need a `set_value() noexcept` member.
+	A schedule() sender only ever completes with set_value().
+*/
+
+class SpscRunLoop
+{
+	/* Type-erased operation state, as seen by the loop. */
+	struct OperationBase
+	{
+		void (*execute)(OperationBase*) noexcept;
+	};
+
+public:
+	using size_type = SpscFifo2<OperationBase*>::size_type;
+
+	class ScheduleSender;
+
+	template<typename TReceiver>
+	class Operation : private OperationBase
+	{
+	public:
+		/* Note: The loop holds a pointer to us between start() and
+		   completion, so we can never move. */
+		Operation(Operation const&) = delete;
+		Operation& operator=(Operation const&) = delete;
+		Operation(Operation&&) = delete;
+		Operation& operator=(Operation&&) = delete;
+
+		/* Note: Submitting thread only. Spins if the loop's queue is full. */
+		void start() noexcept { loop_->enqueue(this); }
+
+	private:
+		friend class ScheduleSender;
+
+		Operation(SpscRunLoop* loop, TReceiver receiver)
+			: OperationBase{&executeImpl}
+			, loop_{loop}
+			, receiver_{std::move(receiver)}
+		{}
+
+		static void executeImpl(OperationBase* base) noexcept
+		{
+			static_cast<Operation*>(base)->receiver_.set_value();
+		}
+
+		SpscRunLoop* loop_;
+		TReceiver    receiver_;
+	};
+
+	class ScheduleSender
+	{
+	public:
+		template<typename TReceiver>
+		Operation<TReceiver> connect(TReceiver receiver) const
+		{
+			return Operation<TReceiver>{loop_, std::move(receiver)};
+		}
+
+	private:
+		friend class SpscRunLoop;
+		explicit ScheduleSender(SpscRunLoop* loop) noexcept : loop_{loop} {}
+
+		SpscRunLoop* loop_;
+	};
+
+	class Scheduler
+	{
+	public:
+		ScheduleSender schedule() const noexcept { return ScheduleSender{loop_}; }
+
+		friend bool operator==(Scheduler, Scheduler) noexcept = default;
+
+	private:
+		friend class SpscRunLoop;
+		explicit Scheduler(SpscRunLoop* loop) noexcept : loop_{loop} {}
+
+		SpscRunLoop* loop_;
+	};
+
+	/* Starts the loop's thread, pinned to 'cpu' (-1 leaves it unpinned). */
+	explicit SpscRunLoop(size_type capacity, int cpu = -1)
+		: queue_{capacity}
+		, thread_{[this, cpu] { run(cpu); }}
+	{}
+
+	SpscRunLoop(SpscRunLoop const&) = delete;
+	SpscRunLoop& operator=(SpscRunLoop const&) = delete;
+	SpscRunLoop(SpscRunLoop&&) = delete;
+	SpscRunLoop& operator=(SpscRunLoop&&) = delete;
+
+	/* Note: Runs everything already started, then joins the loop's thread. */
+	~SpscRunLoop() { finish(); }
+
+	Scheduler getScheduler() noexcept { return Scheduler{this}; }
+
+	/* Asks the loop's thread to exit once the queue is empty, and waits for
+	   it. Nothing may be started afterwards.
+	   Note: Submitting thread only. */
+	void finish()
+	{
+		finishing_.store(true, std::memory_order_release);
+		if (thread_.joinable())
+			thread_.join();
+	}
+
+private:
+	void enqueue(OperationBase* operation) noexcept
+	{
+		while (!queue_.push(operation))
+			;
+	}
+
+	void run(int cpu)
+	{
+		pinThread(cpu, ::pthread_self());
+
+		OperationBase* operation;
+		for (;;)
+		{
+			/* Note: Acquire the flag *before* popping. If the flag was set
+			   and the pop still finds nothing, every start() has been seen. */
+			const bool finishing = finishing_.load(std::memory_order_acquire);
+			if (queue_.pop(operation))
+				operation->execute(operation);
+			else if (finishing)
+				return;
+		}
+	}
+
+	SpscFifo2<OperationBase*> queue_;
+
+	/* Note: Written once by the submitting thread, read on every empty poll
+	   by the loop's thread, so keep it off the queue's lines. */
+	alignas(64) std::atomic<bool> finishing_{};
+
+	std::thread thread_;
+};
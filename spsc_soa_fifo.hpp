@@ -0,0 +1,209 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <span>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "spsc_positions.hpp"
+
+/*
+	A thread-safe Single-Consumer, Single-Producer circular FIFO queue of
+	multi-field records, stored as a struct-of-arrays.
+
+
+	An SpscFifo2 of a record type such as
+
+		struct Tick { double price; std::int64_t size; std::int64_t timestamp; };
+
+	lays the records out one after the other ('array-of-structs'), so a
+	Consumer that wants to run a vectorized kernel over just the prices has to
+	gather them out of every third 8 bytes first. Here, instead, each field
+	gets its own array:
+
+		price:      [p0][p1][p2][p3] ...
+		size:       [s0][s1][s2][s3] ...
+		timestamp:  [t0][t1][t2][t3] ...
+
+	All of the arrays share a single set of push/pop positions - SpscFifo2's
+	own control block, SpscPositions - so pushing or popping a record is
+	still a single Release store. On the Consumer side,
+	`peekSpans()` returns one `std::span` per field over the contiguous run of
+	readable records, which a SIMD kernel can consume directly, and
+	`advanceRead()` then pops the whole run with a single store.
+
+	Each array starts on its own cache line, so the Producer writing field 'a'
+	of a new record never shares a line with the Consumer reading field 'b' of
+	an old one, except at the ends of a run.
+
+	Fields must be trivially copyable, as they're written and read with plain
+	assignment and never explicitly destroyed.
+
+	`SpscSoaFifo<TFields...>` uses the default SpscPositions. For another
+	interference size or index type, name the control block explicitly, e.g.
+	`BasicSpscSoaFifo<SpscPositions<std::uint32_t, 128>, double, float>`.
+*/
+
+template<typename TPositions, typename... TFields>
+class BasicSpscSoaFifo
+{
+	static_assert(sizeof...(TFields) > 0);
+	static_assert((std::is_trivially_copyable_v<TFields> && ...),
+		"SpscSoaFifo fields must be trivially copyable");
+
+public:
+	using positions_type = TPositions;
+	using size_type = typename positions_type::size_type;
+	using value_type = std::tuple<TFields...>;
+
+	template<std::size_t I>
+	using field_type = std::tuple_element_t<I, value_type>;
+
+	/* Alignment of each field's array. */
+	static constexpr std::size_t field_alignment = 64;
+
+	/* Per-field views over a contiguous run of readable records. */
+	class Spans
+	{
+	public:
+		size_type size() const noexcept { return size_; }
+
+		bool empty() const noexcept { return size_ == 0; }
+
+		template<std::size_t I>
+		std::span<field_type<I>> get() const noexcept
+		{
+			return {std::get<I>(fields_), size_};
+		}
+
+	private:
+		friend class BasicSpscSoaFifo;
+		Spans(std::tuple<TFields*...> fields, size_type size) noexcept
+			: fields_{fields}
+			, size_{size}
+		{}
+
+		std::tuple<TFields*...> fields_;
+		size_type               size_;
+	};
+
+	/* Note: If allocating any of the arrays throws, the ones allocated
+	   before it are freed again by their array_ptrs. */
+	explicit BasicSpscSoaFifo(size_type capacity)
+		: capacity_{capacity}
+		, arrays_{allocateArray<TFields>(capacity)...}
+		, positions_{capacity}
+	{}
+
+	BasicSpscSoaFifo(BasicSpscSoaFifo const&) = delete;
+	BasicSpscSoaFifo& operator=(BasicSpscSoaFifo const&) = delete;
+	BasicSpscSoaFifo(BasicSpscSoaFifo&&) = delete;
+	BasicSpscSoaFifo& operator=(BasicSpscSoaFifo&&) = delete;
+
+	size_type getCapacity() const noexcept { return capacity_; }
+
+	size_type getSize() const noexcept { return positions_.getSize(); }
+
+	bool isEmpty() const noexcept { return positions_.isEmpty(); }
+
+	bool isFull() const noexcept { return positions_.isFull(); }
+
+	/* Note: Producer thread only. */
+	bool push(TFields const&... fields)
+	{
+		const size_type push_pos = positions_.getPushPos();
+		if (positions_.getWritable(push_pos) == 0)
+			return false;
+
+		const size_type index = push_pos % capacity_;
+		std::apply([&](auto const&... arrays) {
+			((arrays[index] = fields), ...);
+		}, arrays_);
+
+		positions_.publishPush(push_pos + 1);
+
+		return true;
+	}
+
+	/* Note: Consumer thread only. */
+	bool pop(TFields&... fields)
+	{
+		const size_type pop_pos = positions_.getPopPos();
+		if (positions_.getReadable(pop_pos) == 0)
+			return false;
+
+		const size_type index = pop_pos % capacity_;
+		std::apply([&](auto const&... arrays) {
+			((fields = arrays[index]), ...);
+		}, arrays_);
+
+		positions_.publishPop(pop_pos + 1);
+
+		return true;
+	}
+
+	/* Returns per-field spans over up to 'max' of the oldest records, without
+	   popping them. The run stops at the end of the arrays, so a wrapped
+	   queue takes two calls (with an advanceRead() in between) to drain.
+	   Note: Consumer thread only. */
+	Spans peekSpans(size_type max)
+	{
+		const size_type pop_pos = positions_.getPopPos();
+		const size_type index = pop_pos % capacity_;
+		const size_type n = std::min({max, positions_.getReadable(pop_pos, max),
+			static_cast<size_type>(capacity_ - index)});
+		return Spans{std::apply([index](auto const&... arrays) {
+			return std::tuple<TFields*...>{(arrays.get() + index)...};
+		}, arrays_), n};
+	}
+
+	/* Pops the 'n' oldest records, which must already have been seen by
+	   peekSpans(), with a single store.
+	   Note: Consumer thread only. */
+	void advanceRead(size_type n)
+	{
+		const size_type pop_pos = positions_.getPopPos();
+		assert(n <= positions_.getReadable(pop_pos, 0, 0));
+
+		positions_.publishPop(pop_pos + n);
+	}
+
+private:
+	template<typename TField>
+	static constexpr std::align_val_t array_alignment{
+		std::max(field_alignment, alignof(TField))};
+
+	template<typename TField>
+	struct ArrayDeleter
+	{
+		void operator()(TField* array) const noexcept
+		{
+			::operator delete(static_cast<void*>(array), array_alignment<TField>);
+		}
+	};
+
+	template<typename TField>
+	using array_ptr = std::unique_ptr<TField[], ArrayDeleter<TField>>;
+
+	template<typename TField>
+	static array_ptr<TField> allocateArray(size_type capacity)
+	{
+		/* Note: Aligned 'operator new' (C++17). Each array starts on a cache
+		   line, which also suits aligned SIMD loads.
+		   See: https://en.cppreference.com/w/cpp/memory/new/operator_new */
+		return array_ptr<TField>{static_cast<TField*>(::operator new(
+			capacity * sizeof(TField), array_alignment<TField>))};
+	}
+
+	size_type                          capacity_;  /* Maximum number of records */
+	std::tuple<array_ptr<TFields>...>  arrays_;    /* One array per field */
+	positions_type                     positions_;
+};
+
+template<typename... TFields>
+using SpscSoaFifo = BasicSpscSoaFifo<SpscPositions<>, TFields...>;
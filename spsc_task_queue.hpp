@@ -0,0 +1,282 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "spsc_positions.hpp"
+
+/*
+	A Single-Consumer, Single-Producer queue of type-erased tasks, stored
+	inline.
+
+
+	Handing closures between threads as `std::function` through an SpscFifo2
+	costs a heap allocation per task whenever the captures don't fit in the
+	`std::function`'s own small buffer - and that buffer is implementation
+	defined. Worse, the allocation happens on the Producer thread and the free
+	on the Consumer thread, which is about the worst pattern there is for a
+	memory allocator.
+
+	Instead, this queue stores each callable directly in the ring, in a
+	variable-size 'record':
+
+		+-----------------+-----------+-------------------------+
+		| vtable pointer  | size      | captured state (the Fn) |
+		+-----------------+-----------+-------------------------+
+
+	The vtable is a static, per-callable-type table of function pointers, so
+	the record carries exactly what a virtual call would: one pointer to the
+	type's behaviour plus the object itself. The Consumer invokes the callable
+	where it lies and then destroys it in place - nothing is ever copied out
+	of the ring and nothing is ever allocated, for any callable up to
+	`MaxTaskSize` bytes (checked at compile time).
+
+	Records never straddle the end of the buffer. If the next record doesn't
+	fit in the space left before the end, the Producer writes a 'padding'
+	record (a null vtable) over that space and starts the real record at the
+	front. Both are published together, so the Consumer can always skip a
+	padding record without re-checking the queue.
+
+	Positions are byte offsets, but they live in the same SpscPositions
+	control block as SpscFifo2's, with the same handshake and cached copies
+	of the other side's position.
+*/
+
+/* Note: Optional allocator type for user-specified allocation policies.
+   Note: Optional separation, in bytes, between the position variables, and
+   optional type for the positions and capacity - see SpscPositions. */
+template<std::size_t MaxTaskSize = 64, typename TAlloc = std::allocator<std::byte>,
+	std::size_t InterferenceSize = 64,
+	typename TIndex = typename std::allocator_traits<TAlloc>::size_type>
+class SpscTaskQueue
+{
+	/* Every record starts on a multiple of this, so the header and any
+	   normally-aligned callable can be placed without extra padding. */
+	static constexpr std::size_t record_alignment = alignof(std::max_align_t);
+
+	struct alignas(record_alignment) Block
+	{
+		std::byte bytes[record_alignment];
+	};
+
+	using block_allocator =
+		typename std::allocator_traits<TAlloc>::template rebind_alloc<Block>;
+
+public:
+	using allocator_traits = std::allocator_traits<block_allocator>;
+	using positions_type = SpscPositions<TIndex, InterferenceSize>;
+	using size_type = typename positions_type::size_type;
+
+	static constexpr size_type max_task_size = MaxTaskSize;
+
+	/* Note: 'capacity' is in bytes. It's rounded up to a whole number of
+	   records' alignment, and to at least two of the largest records: a
+	   record that has to wrap needs up to twice its own size, and must still
+	   fit once the queue has drained. With a TIndex narrower than 64 bits,
+	   it's rounded up to a power of two as well. */
+	explicit SpscTaskQueue(size_type capacity, TAlloc const& alloc = TAlloc{})
+		: alloc_{alloc}
+		, blocks_{toBlocks(capacity)}
+		, capacity_{static_cast<size_type>(blocks_ * sizeof(Block))}
+		, allocation_{reinterpret_cast<std::byte*>(
+			allocator_traits::allocate(alloc_, blocks_))}
+		, positions_{capacity_}
+	{}
+
+	SpscTaskQueue(SpscTaskQueue const&) = delete;
+	SpscTaskQueue& operator=(SpscTaskQueue const&) = delete;
+	SpscTaskQueue(SpscTaskQueue&&) = delete;
+	SpscTaskQueue& operator=(SpscTaskQueue&&) = delete;
+
+	/* Note: Tasks still in the queue are destroyed without being run. */
+	~SpscTaskQueue()
+	{
+		size_type pop_pos = positions_.getPopPos();
+		const size_type push_pos = positions_.getPushPos();
+		while (pop_pos != push_pos)
+		{
+			Header* header = headerAt(pop_pos);
+			if (header->vtable != nullptr)
+				header->vtable->destroy(payloadOf(header));
+			pop_pos += header->size;
+		}
+		allocator_traits::deallocate(alloc_,
+			reinterpret_cast<Block*>(allocation_), blocks_);
+	}
+
+	/* Capacity in bytes. */
+	size_type getCapacity() const noexcept { return capacity_; }
+
+	bool isEmpty() const noexcept { return positions_.isEmpty(); }
+
+	/* Moves (or copies) 'task' into the ring. Returns false if there isn't
+	   room for it right now.
+	   Note: Producer thread only. */
+	template<typename F>
+	bool push(F&& task)
+	{
+		using Fn = std::decay_t<F>;
+		static_assert(std::is_invocable_v<Fn&>,
+			"Tasks must be callable with no arguments");
+		static_assert(sizeof(Fn) <= max_task_size,
+			"Task is larger than MaxTaskSize");
+		static_assert(alignof(Fn) <= record_alignment,
+			"Task is over-aligned");
+
+		constexpr size_type size = recordSize(sizeof(Fn));
+
+		size_type push_pos = positions_.getPushPos();
+
+		/* If the record won't fit before the end of the buffer, it needs the
+		   rest of the buffer as padding in front of it. */
+		const size_type tail = capacity_ - push_pos % capacity_;
+		const size_type needed = size > tail ? tail + size : size;
+
+		if (positions_.getWritable(push_pos, needed, needed) < needed)
+			return false;
+
+		if (size > tail)
+		{
+			new (headerAt(push_pos)) Header{nullptr, tail};
+			push_pos += tail;
+		}
+
+		Header* header = new (headerAt(push_pos)) Header{&vtable_for<Fn>, size};
+		new (payloadOf(header)) Fn(std::forward<F>(task));
+
+		/* Note: The padding record, if any, is published along with the
+		   task. */
+		positions_.publishPush(push_pos + size);
+
+		return true;
+	}
+
+	/* Runs the oldest task, then destroys it in place. Returns false if the
+	   queue is empty. If the task throws, it's still destroyed and popped
+	   before the exception propagates.
+	   Note: Consumer thread only. */
+	bool runOne()
+	{
+		const size_type pop_pos = positions_.getPopPos();
+		if (positions_.getReadable(pop_pos) == 0)
+			return false;
+
+		Publisher publisher{*this, pop_pos};
+		run(publisher);
+		return true;
+	}
+
+	/* Runs up to 'max' tasks, publishing pop_pos_ once at the end. Returns
+	   the number of tasks run.
+	   Note: Consumer thread only. */
+	size_type runBatch(size_type max)
+	{
+		/* Note: Only Acquires push_pos_ if the cached copy says we're empty. */
+		const size_type pop_pos = positions_.getPopPos();
+		const size_type push_pos = pop_pos + positions_.getReadable(pop_pos);
+
+		Publisher publisher{*this, pop_pos};
+		size_type n = 0;
+		while (n < max && publisher.pos != push_pos)
+		{
+			run(publisher);
+			++n;
+		}
+		return n;
+	}
+
+private:
+	struct TaskVTable
+	{
+		void (*invokeAndDestroy)(void* storage);
+		void (*destroy)(void* storage);
+	};
+
+	struct alignas(record_alignment) Header
+	{
+		TaskVTable const* vtable;  /* nullptr marks a padding record */
+		size_type         size;    /* Whole record, header included */
+	};
+
+	static_assert(sizeof(Header) == record_alignment);
+
+	template<typename Fn>
+	static constexpr TaskVTable vtable_for{
+		[](void* storage) {
+			Fn& fn = *static_cast<Fn*>(storage);
+			/* Note: Destroy the task even if invoking it throws. */
+			struct Destroyer { Fn& fn; ~Destroyer() { fn.~Fn(); } } destroyer{fn};
+			fn();
+		},
+		[](void* storage) { static_cast<Fn*>(storage)->~Fn(); }
+	};
+
+	/* Publishes the Consumer's position when it goes out of scope, so that
+	   a throwing task can't leave a destroyed record in the queue. */
+	struct Publisher
+	{
+		SpscTaskQueue& queue;
+		size_type      pos;
+		size_type      start = pos;
+
+		~Publisher()
+		{
+			if (pos != start)
+				queue.positions_.publishPop(pos);
+		}
+	};
+
+	/* Runs the task at 'publisher.pos', skipping a padding record first if
+	   there is one, and advances 'publisher.pos' past it. */
+	void run(Publisher& publisher)
+	{
+		Header* header = headerAt(publisher.pos);
+		if (header->vtable == nullptr)
+		{
+			publisher.pos += header->size;
+			header = headerAt(publisher.pos);
+		}
+		publisher.pos += header->size;
+		header->vtable->invokeAndDestroy(payloadOf(header));
+	}
+
+	static size_type toBlocks(size_type capacity) noexcept
+	{
+		const size_type blocks = static_cast<size_type>(
+			(std::max(capacity, 2 * recordSize(max_task_size)) + sizeof(Block) - 1)
+			/ sizeof(Block));
+		/* Note: sizeof(Block) is a power of two, so a power-of-two number of
+		   blocks makes a power-of-two capacity - see SpscPositions. */
+		if constexpr (std::numeric_limits<size_type>::digits < 64)
+			return std::bit_ceil(blocks);
+		return blocks;
+	}
+
+	static constexpr size_type recordSize(size_type taskSize) noexcept
+	{
+		return sizeof(Header)
+			+ (taskSize + record_alignment - 1) / record_alignment * record_alignment;
+	}
+
+	Header* headerAt(size_type pos) const noexcept
+	{
+		return std::launder(reinterpret_cast<Header*>(allocation_ + pos % capacity_));
+	}
+
+	static void* payloadOf(Header* header) noexcept { return header + 1; }
+
+	block_allocator alloc_;
+	size_type       blocks_;      /* Number of Blocks allocated */
+	size_type       capacity_;    /* Capacity in bytes */
+	std::byte*      allocation_;  /* Handle to our allocated block of memory */
+
+	/* Note: Byte offsets: where the next record shall be written, and of the
+	   oldest record. */
+	positions_type  positions_;
+};
@@ -0,0 +1,9 @@
+#pragma once
+
+/* Default timestamp accessor for the timestamp-aware queues: uses the item's
+   `timestamp` member. */
+struct TimestampMember
+{
+	template<typename T>
+	auto operator()(T const& value) const noexcept { return value.timestamp; }
+};